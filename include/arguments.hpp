@@ -1,6 +1,7 @@
 #ifndef ARGUMENTS
 #define ARGUMENTS
 
+#include <string>
 #include <vector>
 class ArgumentParser {
 private:
@@ -9,6 +10,8 @@ private:
 
 public:
     std::vector<std::string> vec;
+    std::string batch_script; // set by --batch
+    bool follow = false; // set by --follow
 
     ArgumentParser(int argc, char** argv);
 
@@ -0,0 +1,63 @@
+#ifndef BATCH
+#define BATCH
+
+#include <regex>
+#include <string>
+#include <vector>
+
+#include "buffer.hpp"
+
+namespace Var {
+
+    /**
+     * One scripted edit
+     *
+     * Script syntax, one command per line ('#' starts a comment):
+     *   s/pattern/replacement/[g]   substitute in every line (any delimiter)
+     *   d/pattern/                  delete lines matching pattern
+     *   i N text                    insert text as line N (1-based, '$' appends)
+     *
+     * Patterns are ECMAScript regular expressions; replacements may
+     * refer to groups with $1, $2, ...
+     */
+    struct BatchCommand {
+        enum class Kind { Substitute, Delete, Insert };
+
+        Kind kind = Kind::Substitute;
+        std::regex pattern;
+        std::string text; // replacement or inserted line
+        bool global = false;
+        int line = 0; // insert position, 0 appends
+    };
+
+    /**
+     * Non-interactive editing of many files with one script
+     *
+     * Files are processed in parallel on a worker pool. Each file is
+     * loaded into a Buffer, every command is applied in order, and the
+     * result is written back atomically (temporary file + rename).
+     * Files without changes are left untouched.
+     */
+    class BatchEditor {
+    private:
+        std::vector<BatchCommand> commands;
+
+        struct Result {
+            size_t edits = 0;
+            double milliseconds = 0;
+            std::string error;
+        };
+
+        static BatchCommand parse_command(const std::string& line, int line_number);
+        size_t apply(Buffer& buffer) const;
+        size_t apply_to_lines(Buffer& buffer, const BatchCommand& command) const;
+        Result process(const std::string& path) const;
+
+    public:
+        explicit BatchEditor(const std::string& script_path);
+        int run(const std::vector<std::string>& files) const;
+
+    };
+}
+
+#endif
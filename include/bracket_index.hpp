@@ -0,0 +1,106 @@
+#ifndef BRACKET_INDEX
+#define BRACKET_INDEX
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "buffer.hpp"
+
+namespace Var {
+
+    /**
+     * Bracket nesting of the whole buffer, for matching without scans
+     *
+     * The text is cut into blocks of about BLOCK_BYTES that end at a
+     * line break, or anywhere outside a string past MAX_BLOCK_BYTES so
+     * a huge line doesn't make a huge block. Each block stores how much it changes the nesting
+     * depth ('{', '[' and '(' open, '}', ']' and ')' close, brackets in
+     * double-quoted strings don't count) and the lowest depth reached
+     * inside it, relative to its start. A segment tree over the blocks
+     * gives the depth at any block start and finds the next (or
+     * previous) block where the depth drops below a given level in
+     * O(log n), so only that block's text has to be scanned.
+     *
+     * Strings end at the end of their line, and every block starts
+     * outside a string. Bracket kinds are not told apart: in unbalanced
+     * text a '(' can match a ']'.
+     *
+     * The index is built in the background, one slice of about
+     * BUILD_GRAIN bytes at a time: the UI thread copies a slice with
+     * next_slice(), scan_slice() runs on a worker and add_slice() appends
+     * its blocks. An edit in text already scanned rescans the blocks
+     * around it, as it would in the finished index; one reaching into
+     * the slice in flight drops that slice.
+     *
+     * Edits rescan only the blocks holding the edited lines. The tree
+     * keeps spare leaves, so blocks added at the end (appended input)
+     * are updated in place; in the middle the number of leaves stays the
+     * same, surplus blocks being merged and missing ones left empty.
+     */
+    class BracketIndex {
+    private:
+        // One block, or the summary of a range of blocks
+        struct Summary {
+            size_t bytes = 0;
+            int newlines = 0;
+            int net = 0; // depth change across the range
+            int min = EMPTY; // lowest depth inside, relative to the start (at most 0)
+        };
+
+        std::vector<Summary> blocks;
+        std::vector<Summary> tree; // tree[1] is the root, leaves start at tree[leaves]
+        size_t leaves = 0;
+        bool built = false;
+
+        // While building: blocks of text [0, scanned_bytes) scanned so
+        // far, the end of the slice in flight and its ticket, bumped when
+        // an edit drops the slice
+        std::vector<Summary> scanned;
+        size_t scanned_bytes = 0;
+        size_t sliced = 0;
+        size_t text_size = 0; // as of the last slice or edit
+        uint64_t slice_ticket = 0;
+
+        static constexpr int EMPTY = 1 << 30; // min of padding leaves, never matches
+        static constexpr size_t BLOCK_BYTES = 16 * 1024;
+        static constexpr size_t MAX_BLOCK_BYTES = 4 * BLOCK_BYTES;
+        static constexpr size_t BUILD_GRAIN = 4 << 20; // bytes per build slice
+
+        static Summary combine(const Summary& a, const Summary& b);
+        static void scan(const std::string& text, size_t begin, size_t end, std::vector<Summary>& out);
+        void edit_while_building(const Buffer& buffer, size_t from, int last_line);
+        void rebuild_tree();
+        void update_leaf(size_t block);
+        Summary prefix(size_t block) const;
+        size_t block_at_offset(size_t pos) const;
+        size_t block_at_line(int line) const;
+        int find_forward(size_t node, size_t lo, size_t hi, size_t from, int depth, int limit) const;
+        int find_backward(size_t node, size_t lo, size_t hi, size_t to, int depth, int limit) const;
+        size_t first_at_most(const Buffer& buffer, size_t from, int limit) const;
+        size_t last_at_most(const Buffer& buffer, size_t to, int limit) const;
+        std::pair<int, char> inspect(const Buffer& buffer, size_t pos) const;
+
+    public:
+        static constexpr size_t NONE = std::string::npos;
+
+        // Text copied for one build step and the blocks scanned from it
+        struct Slice {
+            std::string text;
+            std::vector<Summary> blocks;
+            uint64_t ticket = 0;
+        };
+
+        bool next_slice(const Buffer& buffer, Slice& slice);
+        static void scan_slice(Slice& slice);
+        void add_slice(Slice&& slice);
+        bool ready() const;
+        void lines_changed(const Buffer& buffer, int first_line, int old_count, int new_count, size_t changed_from = 0);
+        size_t match(const Buffer& buffer, size_t pos) const;
+        size_t parent(const Buffer& buffer, size_t pos) const;
+
+    };
+}
+
+#endif
@@ -7,27 +7,40 @@
 #include <fstream>
 #include <string_view>
 
+#include "line_index.hpp"
+
 namespace Var {
 
     class Buffer {
     private:
         std::string text;
-        std::vector<size_t> line_offsets;
+        LineIndex line_index; // start of every line, compacted past its memory budget
+        uint64_t edit_revision = 0; // bumped on every change to text
 
     public:
-        void load_file(const std::string& file_path, std::string& filename);
+        void load_file(const std::string& file_path, std::string& filename, std::vector<size_t> known_offsets = {});
         void reset_buffer_state();
-        void load_and_process_file(const std::string& file_path, std::string& filename);
-        void load_file_content(const std::string& file_path);
+        void load_and_process_file(const std::string& file_path, std::string& filename, std::vector<size_t>&& known_offsets);
+        void load_file_content(const std::string& file_path, std::vector<size_t>&& known_offsets);
         void ensure_minimum_buffer_state();
         void initialize_with_empty_line();
         void handle_load_error(std::string& filename);
         void save_file(const std::string& filename) const;
+        void save_file_atomic(const std::string& filename) const;
         std::string_view get_line(int line_number) const;
         int line_count() const;
         void insert_char(int line, int col, char ch);
+        void insert_line(int line, std::string_view content);
+        void replace_text(std::string&& new_text);
+        void append(std::string_view chunk);
+        void insert(size_t pos, std::string_view content);
+        void erase(size_t begin, size_t end);
         void delete_char_before_cursor(int& line, int& col);
         const std::string& get_text() const;
+        std::vector<size_t> get_line_offsets() const;
+        size_t line_offset(int line) const;
+        bool compact_index() const;
+        uint64_t revision() const;
         void build_line_index();
         void update_line_index_from(size_t pos);
         bool is_invalid_line(int line) const;
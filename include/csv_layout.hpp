@@ -0,0 +1,67 @@
+#ifndef CSV_LAYOUT
+#define CSV_LAYOUT
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "buffer.hpp"
+
+namespace Var {
+
+    // One field of a CSV line, as byte columns within the line
+    struct CsvField {
+        int begin = 0; // first byte of the field, an opening quote included
+        int end = 0; // delimiter (or line end) after the field
+        int text_begin = 0; // shown text, without enclosing quotes
+        int text_end = 0;
+    };
+
+    /**
+     * Column layout for showing delimiter-separated lines as a table
+     *
+     * Lines are split on demand, one visible line at a time, so the
+     * cost of drawing does not depend on the file size. Column widths
+     * come from a fixed sample of lines (the first ones plus lines
+     * spread over the file) taken when the layout is enabled; longer
+     * fields are cut off.
+     *
+     * Quoted fields may contain the delimiter and doubled quotes, but
+     * not line breaks: every buffer line is one record.
+     */
+    class CsvLayout {
+    private:
+        char delimiter = 0;
+        std::vector<int> widths; // per column, from the sample
+        int first_column = 0; // leftmost column on screen
+
+        static constexpr std::string_view CANDIDATES = ",\t;|";
+        static constexpr int DETECT_LINES = 20;
+        static constexpr int HEAD_SAMPLE_LINES = 500;
+        static constexpr int SPREAD_SAMPLE_LINES = 500;
+        static constexpr int MAX_COLUMN_WIDTH = 32;
+        static constexpr int DEFAULT_COLUMN_WIDTH = 10; // columns missing from the sample
+
+        void sample_line(std::string_view line);
+
+    public:
+        static constexpr int SEPARATOR_WIDTH = 3; // " | " between columns
+
+        static char detect_delimiter(const Buffer& buffer);
+        static std::vector<CsvField> split(std::string_view line, char delimiter);
+        static int field_at(const std::vector<CsvField>& fields, int col);
+        static std::string cell_text(std::string_view line, const CsvField& field);
+
+        bool enable(const Buffer& buffer);
+        void disable();
+        bool active() const;
+        char get_delimiter() const;
+        int column_width(int column) const;
+        int get_first_column() const;
+        bool scroll_to(int column, int text_width);
+        int screen_col(std::string_view line, const std::vector<CsvField>& fields, int col) const;
+
+    };
+}
+
+#endif
@@ -2,6 +2,7 @@
 #define CURSOR
 
 #include "buffer.hpp"
+#include "row_index.hpp"
 #include <utility>
 
 namespace Var {
@@ -14,13 +15,22 @@ namespace Var {
     public:
         void clamp_line_position(const Buffer& buffer);
         void clamp_column_position(const Buffer& buffer);
-        void adjust_viewport(const Buffer& buffer, int& viewport_y) const;
+        void adjust_viewport(const Buffer& buffer, const RowIndex& row_index, int& viewport_y, int text_rows) const;
         void move_left(const Buffer& buffer);
         void move_right(const Buffer& buffer);
-        void move_up(const Buffer& buffer);
-        void move_down(const Buffer& buffer);
+        void move_up(const Buffer& buffer, const RowIndex& row_index);
+        void move_down(const Buffer& buffer, const RowIndex& row_index);
+        void move_page_up(const Buffer& buffer, const RowIndex& row_index, int page_rows);
+        void move_page_down(const Buffer& buffer, const RowIndex& row_index, int page_rows);
+        void move_to_visual_row(const Buffer& buffer, const RowIndex& row_index, int row);
+        void move_to_line_start();
+        void move_to_line_end(const Buffer& buffer);
+        void move_to_buffer_start();
+        void move_to_buffer_end(const Buffer& buffer);
+        void go_to_line(const Buffer& buffer, int line);
+        void go_to_offset(const Buffer& buffer, size_t offset);
         // void tab(const Buffer& buffer);
-        void clamp(const Buffer& buffer, int& viewport_y);
+        void clamp(const Buffer& buffer, const RowIndex& row_index, int& viewport_y, int text_rows);
         std::pair<int, int> position() const;
         void set_position(int line, int col);
         bool can_move_up() const;
@@ -31,6 +41,7 @@ namespace Var {
         void move_to_prev_line_end(const Buffer& buffer);
         void move_to_next_line_start();
         void adjust_col_for_line(const Buffer& buffer);
+        int visual_row(const Buffer& buffer, const RowIndex& row_index) const;
 
     };
 }
@@ -0,0 +1,81 @@
+#ifndef DISK_DIFF
+#define DISK_DIFF
+
+#include <climits>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "buffer.hpp"
+#include "worker_pool.hpp"
+
+namespace Var {
+
+    // Gutter marker of a buffer line relative to the file on disk
+    enum class LineMark : uint8_t {
+        None,
+        Added,        // line not present on disk
+        Changed,      // line replaces a different line on disk
+        RemovedAbove, // disk lines were deleted right before this line
+        RemovedBelow  // disk lines were deleted after the last line
+    };
+
+    /**
+     * Line diff between the buffer and its file on disk
+     *
+     * Both sides are reduced to one 64-bit hash per line (hashed in
+     * parallel for big files) and compared with Myers' algorithm over
+     * the hash sequences.
+     *
+     * The file on disk is read and hashed by load() on a worker
+     * thread, between start() and finish() on the UI thread; the buffer
+     * is hashed by finish(), so edits made meanwhile need no care. A
+     * load overtaken by disable() or another start() is dropped.
+     *
+     * Edits update the result incrementally: only the edited lines are
+     * rehashed, and only the stretch between the nearest unchanged lines
+     * that still match the disk is diffed again. Once that stretch is
+     * too big to rediff on every keystroke it is simply shown as changed.
+     */
+    class DiskDiff {
+    private:
+        std::vector<uint64_t> disk_hashes;
+        std::vector<uint64_t> buffer_hashes;
+        std::vector<int> disk_line_of; // buffer line -> matching disk line, -1 if none
+        std::vector<LineMark> marks;
+        bool enabled = false;
+        bool load_pending = false;
+        uint64_t load_request = 0; // bumped by start() and disable()
+
+        // Larger edit distances inside one region are shown as a block change
+        static constexpr int MAX_EDIT_DISTANCE = 4096;
+        // Larger regions left to rediff after an edit (buffer plus disk
+        // lines) are shown as changed without running Myers
+        static constexpr int MAX_EDIT_REGION = 2048;
+        static constexpr size_t HASH_GRAIN = 64 * 1024; // lines per hashing job
+
+        static std::vector<uint64_t> hash_lines(const Buffer& buffer, WorkerPool& workers);
+        static void hash_range(const Buffer& buffer, size_t begin, size_t end, std::vector<uint64_t>& hashes);
+        static uint64_t hash_line(std::string_view line);
+        static std::vector<std::pair<int, int>> myers(const uint64_t* a, int n, const uint64_t* b, int m);
+        void diff_region(int buffer_begin, int buffer_end, int disk_begin, int disk_end, int max_region = INT_MAX);
+        void update_marks(int first_line, int last_line);
+
+    public:
+        static std::vector<uint64_t> load(const std::string& path);
+
+        uint64_t start();
+        bool pending(uint64_t request) const;
+        void finish(const Buffer& buffer, std::vector<uint64_t>&& disk, WorkerPool& workers);
+        void disable();
+        bool active() const;
+        bool loading() const;
+        void saved();
+        void lines_changed(const Buffer& buffer, int first_line, int old_count, int new_count);
+        LineMark mark(int line) const;
+
+    };
+}
+
+#endif
@@ -3,32 +3,151 @@
 
 #include <string>
 #include <vector>
+#include <functional>
+#include <atomic>
+#include <memory>
 
 #include "cursor.hpp"
 #include "buffer.hpp"
 #include "viewport.hpp"
+#include "event_loop.hpp"
+#include "worker_pool.hpp"
+#include "line_index_cache.hpp"
+#include "disk_diff.hpp"
+#include "file_follower.hpp"
+#include "window_layout.hpp"
+#include "hex_view.hpp"
+#include "bracket_index.hpp"
+#include "word_index.hpp"
 
 namespace Var {
         
     class Editor {
     private:
+        // One split of the screen; all windows show the same buffer
+        struct Window {
+            Viewport viewport;
+            Cursor cursor;
+        };
+
         Buffer buffer;
-        Cursor cursor;
-        Viewport viewport;
+        std::vector<Window> windows{1};
+        size_t active = 0; // window receiving input
+        WindowLayout layout;
+        std::vector<WindowRect> separators;
         std::string filename;
         bool running = true;
         bool modified = false;
+
+        // Set whenever something visible changed; the loop repaints once
+        // per batch of events instead of after every wakeup
+        bool dirty = true;
+
+        EventLoop loop;
+        WorkerPool workers;
+        LineIndexCache index_cache;
+        LineIndexCache::FileIdentity loaded_identity; // of the file as it was read
+        DiskDiff diff;
+        BracketIndex brackets;
+        HexView hex; // replaces the windows for binary files
+        int message_timer = 0;
+
+        // Words for completion. They are counted on a thread of their
+        // own, so a long count never holds up jobs the UI waits for on
+        // workers; setting indexing_stop abandons the running count.
+        WordIndex words;
+        WorkerPool indexer{1};
+        std::shared_ptr<std::atomic<bool>> indexing_stop;
+
+        // Open completion popup: words offered, the highlighted one and
+        // the length of the prefix they complete
+        std::vector<std::string> completions;
+        int completion_choice = 0;
+        size_t completion_prefix = 0;
+        static constexpr size_t MAX_COMPLETIONS = 8;
+
+        // Open status bar prompt: its label, the text typed so far and
+        // what to do with it once entered; no prompt while done is empty
+        std::string prompt_label;
+        std::string prompt_input;
+        std::function<void(const std::string&)> prompt_done;
+
+        // Duplicate of the original stdin while a pipe is streamed in, else -1
+        int stream_fd = -1;
+        std::string stream_name;
+
+        // Follow mode (-f): appends are read after a short delay so a
+        // busy log costs one read and one repaint per FOLLOW_DELAY_MS
+        FileFollower follower;
+        int follow_timer = 0;
+        int follow_poll_timer = 0;
+        static constexpr int FOLLOW_DELAY_MS = 50;
+        static constexpr int FOLLOW_POLL_MS = 1000; // catches rotation to a new file
+
+        // Key codes for Ctrl+Home / Ctrl+End, resolved from terminfo at startup
+        int ctrl_home_key = -1;
+        int ctrl_end_key = -1;
+
+        // Smallest window a split may leave behind, status bar included
+        static constexpr int MIN_WINDOW_WIDTH = 12;
+        static constexpr int MIN_WINDOW_HEIGHT = 3;
             
     public:
         static Editor& get();
         void load_file(const std::string& file_path);
+        void open_stdin();
+        void follow();
         void run();
         void handle_input(int ch);
+        void run_in_background(std::function<void()> work, EventLoop::Callback done);
+        void show_message(const std::string& message);
         Editor(const Editor&) = delete;
         Editor& operator=(const Editor&) = delete;
             
     private:
         Editor() = default;
+        Viewport& viewport();
+        Cursor& cursor();
+        void render();
+        void arrange_windows();
+        void split_window(bool side_by_side);
+        void close_window();
+        void other_window();
+        void invalidate_windows();
+        void handle_hex_input(int ch);
+        int bind_extended_key(const char* capability, const char* fallback, int code);
+        void read_input();
+        void resize();
+        void page(int direction, int& viewport_y);
+        void prompt(const std::string& label, std::function<void(const std::string&)> done);
+        void handle_prompt_key(int ch);
+        void draw_prompt();
+        static size_t parse_offset(const std::string& text);
+        void go_to(const std::string& target);
+        void remember_view();
+        void lines_changed(int first_line, int old_count, int new_count, size_t changed_from = 0);
+        void toggle_diff();
+        void load_diff();
+        void toggle_fold();
+        void jump_to_match();
+        void jump_to_parent();
+        void select_enclosing_block();
+        void move_to_field(int direction);
+        void delete_selection(size_t begin, size_t end);
+        void index_brackets();
+        void index_words();
+        void count_next_slice(uint64_t generation, std::shared_ptr<WordIndex::Tally> tally);
+        void complete_word(bool on_request);
+        bool handle_completion_key(int ch);
+        void accept_completion();
+        void close_completions();
+        void read_stream();
+        void append_input(std::string_view chunk, bool keep_at_end);
+        void schedule_follow(int delay_ms);
+        void read_follow();
+        void stop_following();
+        void scroll_to_cursor();
+        void scroll_windows_to_cursor();
     };
 }
 
@@ -0,0 +1,71 @@
+#ifndef EVENT_LOOP
+#define EVENT_LOOP
+
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace Var {
+
+    /**
+     * Single-threaded poll() based event loop
+     *
+     * Multiplexes:
+     * - readable file descriptors (stdin, pipes, inotify, ...)
+     * - SIGWINCH, received synchronously through a signalfd
+     * - one-shot and repeating timers
+     * - a completion queue that worker threads feed through an eventfd
+     *
+     * All callbacks run on the thread calling run_once(); post() is the
+     * only method that may be called from other threads.
+     */
+    class EventLoop {
+    public:
+        using Callback = std::function<void()>;
+        using Clock = std::chrono::steady_clock;
+
+    private:
+        struct Timer {
+            Clock::time_point deadline;
+            std::chrono::milliseconds interval;
+            Callback callback;
+            bool repeat;
+        };
+
+        std::map<int, Callback> watchers; // fd -> readable callback
+        std::map<int, Timer> timers; // id -> timer
+        int next_timer_id = 1;
+
+        int signal_fd = -1;
+        Callback resize_callback;
+
+        int wake_fd = -1;
+        std::mutex completions_mutex;
+        std::deque<Callback> completions;
+
+        int poll_timeout() const;
+        void run_due_timers();
+        void drain_signals();
+        void drain_completions();
+
+    public:
+        EventLoop();
+        ~EventLoop();
+        EventLoop(const EventLoop&) = delete;
+        EventLoop& operator=(const EventLoop&) = delete;
+
+        void watch(int fd, Callback on_readable);
+        void unwatch(int fd);
+        int add_timer(int interval_ms, Callback callback, bool repeat = false);
+        void cancel_timer(int id);
+        void on_resize(Callback callback);
+        void post(Callback completion);
+        void run_once();
+
+    };
+}
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef FILE_FOLLOWER
+#define FILE_FOLLOWER
+
+#include <string>
+#include <sys/types.h>
+
+namespace Var {
+
+    /**
+     * Watches a file that other programs append to (tail -f)
+     *
+     * Appends are noticed through inotify and only the bytes past the
+     * last read offset are read back, so earlier content is never
+     * touched again. A file that shrinks (truncated) or whose path now
+     * names a different inode (rotated) is read again from the start.
+     */
+    class FileFollower {
+    public:
+        enum class Change {
+            None,
+            Appended, // text continues the previous content
+            Replaced  // text is the whole new content of the file
+        };
+
+    private:
+        std::string path;
+        int fd = -1;
+        int notify_fd = -1;
+        int notify_watch = -1;
+        dev_t device = 0;
+        ino_t inode = 0;
+        off_t offset = 0; // bytes of the file already read
+        bool behind = false; // more data was available than one read takes
+
+        // Upper bound of a single read(), keeps each wakeup short
+        static constexpr size_t MAX_READ = 4 << 20;
+
+        void open_file();
+        void close_file();
+
+    public:
+        ~FileFollower();
+
+        void start(const std::string& file_path, off_t known_size);
+        void stop();
+        bool active() const;
+        int descriptor() const;
+        void drain_notifications();
+        Change read_changes(std::string& text);
+        void saved(off_t size);
+        bool has_more() const;
+
+    };
+}
+
+#endif
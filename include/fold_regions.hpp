@@ -0,0 +1,39 @@
+#ifndef FOLD_REGIONS
+#define FOLD_REGIONS
+
+#include <string_view>
+#include <utility>
+
+#include "buffer.hpp"
+#include "bracket_index.hpp"
+
+namespace Var {
+
+    /**
+     * Finds the foldable region around a line
+     *
+     * Two kinds of regions are recognised:
+     * - brackets: a line with an unclosed '{', '[' or '(' folds up to
+     *   the line before its closing bracket, so the closing line stays
+     *   visible. Matching is left to the BracketIndex, so folds and
+     *   bracket jumps agree.
+     * - indentation: the following lines indented deeper than the line
+     *   (blank lines included when more indented lines follow).
+     *
+     * Regions are returned as {header, last hidden line}, or {-1, -1}
+     * when there is nothing to fold.
+     */
+    class FoldRegions {
+    private:
+        static std::pair<int, int> bracket_region(const Buffer& buffer, const BracketIndex& brackets, int line);
+        static std::pair<int, int> indent_region(const Buffer& buffer, int line);
+        static int indent_of(std::string_view line);
+
+    public:
+        static std::pair<int, int> at(const Buffer& buffer, const BracketIndex& brackets, int line);
+        static std::pair<int, int> enclosing(const Buffer& buffer, const BracketIndex& brackets, int line);
+
+    };
+}
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef HEX_VIEW
+#define HEX_VIEW
+
+#include <map>
+#include <string>
+
+namespace Var {
+
+    /**
+     * Hex view of a binary file (offset | hex bytes | ASCII)
+     *
+     * The file is mapped read-only and never copied, so opening is
+     * instant whatever its size. Rows have a fixed width of
+     * BYTES_PER_ROW bytes, so the offset of a row is plain arithmetic.
+     *
+     * Editing overwrites bytes in place: changed bytes are kept in a
+     * small overlay on top of the mapping and written back to their
+     * offsets on save. The file never grows or shrinks.
+     */
+    class HexView {
+    private:
+        std::string path;
+        const unsigned char* data = nullptr; // read-only mapping of the file
+        size_t size = 0;
+        std::map<size_t, unsigned char> patches; // unsaved overwrites by offset
+
+        size_t cursor = 0; // byte offset
+        bool low_nibble = false; // next hex digit replaces the low half
+        bool ascii_side = false; // typing goes to the ASCII column
+        size_t top_row = 0;
+        int text_rows = 1;
+        std::string message;
+
+        static constexpr size_t SNIFF_BYTES = 8000; // read to detect binary files
+
+        unsigned char byte_at(size_t offset) const;
+        size_t row_count() const;
+        int offset_digits() const;
+        void scroll_to_cursor();
+        void draw_row(size_t row, int screen_row, int offset_width, int width) const;
+        void draw_status_bar(const std::string& filename, int row, int width) const;
+
+    public:
+        static constexpr int BYTES_PER_ROW = 16;
+
+        ~HexView();
+
+        static bool is_binary(const std::string& file_path);
+        void open(const std::string& file_path);
+        void close();
+        bool active() const;
+        bool modified() const;
+        void draw(const std::string& filename);
+        void move_by(long long delta);
+        void move_to(size_t offset);
+        void page(int direction);
+        void move_to_row_start();
+        void move_to_row_end();
+        void toggle_side();
+        bool overwrite(int ch);
+        void save();
+        void set_message(const std::string& text);
+
+    };
+}
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef LINE_INDEX
+#define LINE_INDEX
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Var {
+
+    /**
+     * Start offsets of the lines of a text
+     *
+     * Dense mode keeps one size_t per line. Once that would exceed the
+     * memory budget the index turns compact: only every BLOCK_LINES-th
+     * offset (a checkpoint) is kept, about 0.125 bytes per line, and a
+     * block's other offsets are decoded from the text on demand by
+     * scanning for its newlines. Decoded blocks go into a small
+     * direct-mapped cache, so the lines on screen cost one scan per
+     * block rather than one per lookup.
+     *
+     * Offsets are only ever appended or truncated at the end, which is
+     * all the buffer's incremental reindexing needs. Lookups that take
+     * the text expect the text the index was built from.
+     */
+    class LineIndex {
+    private:
+        // Dense mode
+        std::vector<size_t> offsets;
+
+        // Compact mode
+        std::vector<size_t> checkpoints; // start of lines 0, BLOCK_LINES, 2 * BLOCK_LINES, ...
+        size_t lines = 0;
+        bool compact = false;
+        size_t budget;
+
+        struct DecodedBlock {
+            size_t block = SIZE_MAX;
+            std::vector<size_t> offsets;
+        };
+        mutable std::array<DecodedBlock, 32> cache; // slot = block % size
+        mutable std::mutex cache_mutex; // lookups may come from worker threads
+
+        const DecodedBlock& decode(const std::string& text, size_t block) const;
+        size_t lines_in_block(size_t block) const;
+        void make_compact();
+        void forget_blocks_from(size_t block);
+
+    public:
+        static constexpr size_t BLOCK_LINES = 64;
+        static constexpr size_t DEFAULT_BUDGET = 64ull << 20; // bytes of dense offsets
+
+        explicit LineIndex(size_t budget = DEFAULT_BUDGET);
+        LineIndex(const LineIndex&) = delete;
+        LineIndex& operator=(const LineIndex&) = delete;
+
+        void assign(std::vector<size_t>&& line_offsets);
+        void clear();
+        void push_back(size_t offset);
+        void truncate(size_t line_count);
+        size_t size() const;
+        bool empty() const;
+        bool is_compact() const;
+        size_t offset(const std::string& text, size_t line) const;
+        size_t line_of(const std::string& text, size_t pos) const;
+        std::vector<size_t> to_vector(const std::string& text) const;
+
+    };
+}
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef LINE_INDEX_CACHE
+#define LINE_INDEX_CACHE
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Var {
+
+    /**
+     * Line index and view position remembered for a file
+     */
+    struct CachedView {
+        std::vector<size_t> line_offsets;
+        int cursor_line = 0;
+        int cursor_col = 0;
+        int top_line = 0;
+    };
+
+    /**
+     * Persistent on-disk cache of line indexes
+     *
+     * Lets a reopened file skip line indexing and land on the previous
+     * cursor position. An entry is only written while the file on disk
+     * is still the one the index was built from. Entries live in $XDG_CACHE_HOME/var (falling back
+     * to ~/.cache/var), one file per path, and are only trusted when the
+     * file's path, size, mtime and a hash of sampled content all match.
+     *
+     * The directory is bounded to max_bytes; least recently used entries
+     * (by entry mtime, refreshed on every hit) are evicted first.
+     *
+     * The cache is best-effort: every failure is treated as a miss.
+     */
+    class LineIndexCache {
+    public:
+        // What an entry is validated against
+        struct FileIdentity {
+            std::string path; // absolute
+            uint64_t size = 0;
+            int64_t mtime_ns = 0;
+            uint64_t sample_hash = 0;
+
+            bool operator==(const FileIdentity& other) const;
+        };
+
+    private:
+        std::string directory;
+        uint64_t max_bytes;
+
+        // Content sampling used to detect in-place rewrites that keep size and mtime
+        static constexpr int SAMPLE_COUNT = 16;
+        static constexpr size_t SAMPLE_SIZE = 4096;
+
+        std::string entry_path(const std::string& absolute_path) const;
+        void evict(const std::string& keep) const;
+
+    public:
+        static constexpr uint64_t DEFAULT_MAX_BYTES = 64ull << 20;
+
+        explicit LineIndexCache(uint64_t max_bytes = DEFAULT_MAX_BYTES);
+        bool load(const std::string& file_path, CachedView& view, FileIdentity& identity) const;
+        void store(const std::string& file_path, const CachedView& view, const FileIdentity& loaded) const;
+        bool identify(const std::string& file_path, FileIdentity& identity) const;
+
+    };
+}
+
+#endif
@@ -0,0 +1,109 @@
+#ifndef ROW_INDEX
+#define ROW_INDEX
+
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "buffer.hpp"
+
+namespace Var {
+
+    /**
+     * Maps buffer lines to visual (screen) rows for soft wrapping and
+     * folding
+     *
+     * Keeps the number of rows each line occupies in blocks of up to
+     * MAX_BLOCK_LINES lines, with sum segment trees over the blocks'
+     * line and row totals. Both directions of the mapping (line -> first
+     * row, row -> line) walk down the trees in O(log n) and scan one
+     * block. Inserting or removing lines only shifts the entries of the
+     * blocks they are in; the trees over the blocks are rebuilt only
+     * when a block overflows and is split, or is emptied and dropped.
+     *
+     * Row counts are measured lazily: a width change only bumps the
+     * generation counter, and a line is re-measured the next time it is
+     * looked at through measure(). Until then its previous count is used
+     * as an estimate.
+     *
+     * A fold hides a range of lines by flagging them; a flagged line
+     * counts as zero rows. The flags are kept with the lines, so they
+     * move along with them on edits, and a block fully inside a fold is
+     * hidden or shown without summing its lines.
+     *
+     * When neither wrapping nor folding the mapping is the identity and
+     * no memory is used.
+     */
+    class RowIndex {
+    private:
+        // A run of consecutive lines: their row counts, the width
+        // generation each was last measured at and whether a fold hides it
+        struct Block {
+            std::vector<uint32_t> counts;
+            std::vector<uint32_t> measured_at;
+            std::vector<uint8_t> hidden;
+            uint32_t total = 0; // rows of all lines, hidden or not
+            uint32_t rows = 0; // rows of the visible lines
+        };
+        std::vector<Block> blocks;
+
+        // Sum trees over the blocks' line counts and visible rows, leaves
+        // start at leaf_base. Spare leaves past the last block stay zero.
+        std::vector<uint32_t> line_tree;
+        std::vector<uint32_t> row_tree;
+        size_t leaf_base = 1;
+
+        // Folded ranges: header line -> last hidden line. Folds never
+        // overlap; the header itself stays visible.
+        std::map<int, int> folds;
+
+        uint32_t generation = 1;
+
+        int lines = 0;
+        int wrap_width = 0;
+        bool wrap = false;
+        bool enabled = false; // blocks in use: wrapping or folded
+
+        static constexpr size_t BLOCK_LINES = 256; // lines per block after a rebuild or split
+        static constexpr size_t MAX_BLOCK_LINES = 2 * BLOCK_LINES;
+
+        void build_trees();
+        void refresh(size_t first_block, size_t last_block);
+        std::pair<size_t, size_t> find_line(int line) const;
+        static void recount(Block& block);
+        void split(size_t block);
+        void rebuild(const Buffer& buffer);
+        void release();
+        void set_count(size_t block, size_t at, uint32_t count);
+        uint32_t count_rows(const Buffer& buffer, int line) const;
+        void set_hidden(int first_line, int last_line, bool hide);
+        void drop_folds(int first_line, int old_count, int new_count);
+
+    public:
+        // width() while soft wrap is off: every line is one segment
+        static constexpr int UNWRAPPED = std::numeric_limits<int>::max();
+
+        void enable(const Buffer& buffer, int width);
+        void disable(const Buffer& buffer);
+        bool active() const;
+        bool wrapping() const;
+        void set_width(int width);
+        int width() const;
+        void sync(const Buffer& buffer);
+        void measure(const Buffer& buffer, int line);
+        void splice(const Buffer& buffer, int first_line, int old_count, int new_count);
+        int rows_of(int line) const;
+        int row_of_line(int line) const;
+        std::pair<int, int> locate(int row) const;
+        int total_rows() const;
+        void fold(const Buffer& buffer, int header, int last_line);
+        void unfold(int header);
+        int fold_end(int line) const;
+        int fold_containing(int line) const;
+
+    };
+}
+
+#endif
@@ -2,9 +2,18 @@
 #define VIEWPORT
 
 #include <ncurses.h>
+#include <climits>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include "buffer.hpp"
 #include "cursor.hpp"
+#include "row_index.hpp"
+#include "disk_diff.hpp"
+#include "window_layout.hpp"
+#include "bracket_index.hpp"
+#include "csv_layout.hpp"
 
 namespace Var {
 
@@ -13,48 +22,140 @@ namespace Var {
      *
      * Implements:
      * - Double-buffered display to prevent flickering
-     * - Line number gutter
+     * - Line number gutter with diff markers
      * - Status bar with file information
      * - Cursor position highlighting
      * - Viewport scrolling
+     * - Optional soft wrapping of long lines
+     * - Folded line ranges
+     * - Reuse of the last frame's rows for small scroll steps
+     * - Table view of CSV/TSV files with aligned columns
+     * - Word completion popup at the cursor
+     * - Placement anywhere on screen, so several viewports can show
+     *   the same buffer side by side
      */
     class Viewport {
     private:
-        // Vertical scroll offset (lines scrolled down)
+        // Vertical scroll offset (visual rows scrolled down; equal to
+        // buffer lines while soft wrap is off)
         int viewport_y = 0;
 
-        // Current dimensions of visible area
+        // Screen area of the viewport, including its status bar
+        int top = 0;
+        int left = 0;
         int width = 0; // in characters
         int height = 0; // in lines
 
         // Toggle for line numbers display
         bool show_line_numbers = true;
 
+        // Line -> visual row mapping used for soft wrapping and folding
+        RowIndex row_index;
+
+        // Transient text shown in the status bar
+        std::string message;
+
+        // Changes against the file on disk, marked in the gutter
+        const DiskDiff* diff = nullptr;
+
+        // Bracket nesting, to highlight the bracket matching the cursor
+        const BracketIndex* brackets = nullptr;
+        int match_line = -1;
+        int match_col = 0;
+
+        // Column layout while the buffer is shown as a table
+        CsvLayout csv;
+
+        // Selected text as buffer offsets [begin, end), none when equal
+        size_t selection_begin = 0;
+        size_t selection_end = 0;
+
+        // Completion popup: words offered, the highlighted one and the
+        // length of the typed prefix they continue; hidden when empty
+        std::vector<std::string> completions;
+        int completion_choice = 0;
+        int completion_prefix = 0;
+
         // Double buffering system
-        WINDOW* front_buffer; // Primary buffer (stdscr)
-        WINDOW* back_buffer; // Secondary buffer for rendering
+        WINDOW* front_buffer = nullptr; // Primary buffer (stdscr)
+        WINDOW* back_buffer = nullptr; // Secondary buffer for rendering
+
+        // What the back buffer currently shows, used to tell a pure
+        // scroll (shift + draw exposed rows) from a full repaint
+        bool frame_valid = false;
+        int frame_y = 0;
+        int frame_cursor_row = 0;
+        int frame_cursor_rows = 0;
+        int frame_match_line = -1;
+        uint64_t frame_revision = 0;
+
+        // Lines edited since the last frame as [first, end) ranges; only
+        // their rows are redrawn. Rows the edits moved are shifted in the
+        // back buffer right away, and only their line numbers (from line
+        // renumber_from down) are redrawn.
+        std::vector<std::pair<int, int>> damage;
+        int renumber_from = INT_MAX;
+        bool damage_reported = false; // lines_changed() ran since the last frame
+
+        // Largest step (in rows) still handled by shifting the screen
+        static constexpr int MAX_SCROLL_FRACTION = 2; // up to half the text rows
+
+        // Damaged ranges kept apart before they are merged into one
+        static constexpr size_t MAX_DAMAGE_RANGES = 8;
 
         // Line numbers gutter formatting
         static constexpr int LINE_NUMBERS_WIDTH = 6; // Total gutter width
         static constexpr int LINE_NUMBERS_SEPARATOR_COL = 5; // Position of '|' separator
+        static constexpr int DIFF_MARK_COL = 4; // Position of the +/~/- diff marker
             
     public:
-        void draw(const Buffer& buffer, const Cursor& cursor, bool modified, const std::string& filename);
+        void draw(const Buffer& buffer, const Cursor& cursor, bool modified, const std::string& filename, bool focused = true);
         void update_dimensions();
-        int calculate_text_start_column(int cursor_line, int total_lines) const;
-        void draw_buffer_content(const Buffer& buffer, int cursor_line, int text_start_col, const Cursor& cursor);
+        int calculate_text_start_column() const;
+        void settle(const Buffer& buffer, const Cursor& cursor);
+        void measure_visible(const Buffer& buffer);
+        void draw_buffer_content(const Buffer& buffer, int cursor_line, int text_start_col, const Cursor& cursor, int first_row, int last_row);
+        int scroll_shift() const;
+        void shift_rows(int first_row, int shift);
+        void add_damage(int first_line, int end_line);
+        void draw_rows(const Buffer& buffer, const Cursor& cursor, int text_start_col, int first_row, int last_row);
+        void draw_damage(const Buffer& buffer, const Cursor& cursor, int text_start_col);
+        void draw_line_rows(const Buffer& buffer, const Cursor& cursor, int text_start_col, int line);
+        void find_match(const Buffer& buffer, const Cursor& cursor);
+        void invalidate();
         void init_buffers();
+        void release_buffers();
         void swap_buffers();
-        void draw_line(const Buffer& buffer, int buffer_line, int screen_row, int start_col, bool is_cursor_line, const Cursor& cursor);
+        void draw_line(const Buffer& buffer, int buffer_line, int sub_row, int screen_row, int start_col, bool is_cursor_line, const Cursor& cursor);
+        void draw_csv_line(const Buffer& buffer, int buffer_line, int screen_row, int start_col, bool is_cursor_line, const Cursor& cursor);
+        void draw_completions(const Buffer& buffer, const Cursor& cursor, int text_start_col);
+        int cursor_screen_col(const Buffer& buffer, const Cursor& cursor, int text_start_col) const;
         void position_cursor(const Buffer& buffer, const Cursor& cursor, int text_start_col);
-        bool is_cursor_visible(int cursor_line) const;
-        void draw_status_bar(const Buffer& buffer, const Cursor& cursor, bool modified, const std::string& filename);
-        void draw_line_numbers(int current_line, int total_lines) const;
+        bool is_cursor_visible(int cursor_row) const;
+        void draw_status_bar(const Buffer& buffer, const Cursor& cursor, bool modified, const std::string& filename, bool focused);
+        void draw_line_numbers(int current_line, int total_lines, int first_row, int last_row) const;
         void draw_line_number(int screen_row, int line_num, bool is_current_line) const;
-        void update_size(int w, int h);
+        void draw_diff_mark(int screen_row, int buffer_line) const;
+        void place(int new_top, int new_left, int w, int h);
         void toggle_line_numbers();
+        void toggle_soft_wrap(const Buffer& buffer);
+        bool toggle_csv(const Buffer& buffer);
+        const CsvLayout* csv_layout() const;
+        void fold(const Buffer& buffer, int header, int last_line);
+        void unfold(int header);
+        void reveal(int line);
+        void lines_changed(const Buffer& buffer, int first_line, int old_count, int new_count);
+        const RowIndex& rows() const;
+        int page_rows() const;
+        void set_message(const std::string& text);
+        void set_diff(const DiskDiff* disk_diff);
+        void set_brackets(const BracketIndex* bracket_index);
+        void set_selection(size_t begin, size_t end);
+        std::pair<size_t, size_t> selection() const;
+        void set_completions(const std::vector<std::string>& words, int choice, int prefix_length);
         int get_y() const;
         void set_y(int y);
+        WindowRect area() const;
 
     };
 }
@@ -0,0 +1,52 @@
+#ifndef WINDOW_LAYOUT
+#define WINDOW_LAYOUT
+
+#include <memory>
+#include <vector>
+
+namespace Var {
+
+    // Screen area in character cells
+    struct WindowRect {
+        int top = 0;
+        int left = 0;
+        int width = 0;
+        int height = 0;
+    };
+
+    /**
+     * Arrangement of split windows on the screen
+     *
+     * A binary tree: leaves are windows (numbered 0..n-1 by the
+     * caller), inner nodes split their area in half, either into a top
+     * and a bottom part or side by side with a one column separator.
+     * Closing a window gives its area to its sibling.
+     */
+    class WindowLayout {
+    private:
+        struct Node {
+            int window = -1; // leaf: window number; inner nodes: -1
+            bool side_by_side = false;
+            std::unique_ptr<Node> first;
+            std::unique_ptr<Node> second;
+        };
+
+        std::unique_ptr<Node> root;
+
+        static Node* find(Node* node, int window, Node** parent);
+        static void renumber(Node* node, int closed);
+        static void arrange_node(const Node* node, WindowRect area, std::vector<WindowRect>& windows,
+                                 std::vector<WindowRect>& separators);
+
+    public:
+        WindowLayout();
+
+        void split(int window, bool side_by_side, int new_window);
+        void close(int window);
+        void arrange(int width, int height, std::vector<WindowRect>& windows,
+                     std::vector<WindowRect>& separators) const;
+
+    };
+}
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef WORD_INDEX
+#define WORD_INDEX
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace Var {
+
+    /**
+     * Words of the buffer with their number of occurrences, for
+     * completing the word at the cursor
+     *
+     * A word is a run of letters, digits and '_' that doesn't start
+     * with a digit, MIN_WORD_LENGTH to MAX_WORD_LENGTH bytes long.
+     * The table is sorted, so all words with a given prefix are one
+     * range of it.
+     *
+     * The text is counted on a worker thread, one slice at a time: the
+     * UI thread copies a slice with next_slice() and count() adds its
+     * words to a tally, so the whole buffer is never copied at once.
+     * Edits are reported before and after they happen (before_edit(),
+     * after_edit()) and only recount the words around the edited range.
+     * While a count is running, edits to text already sliced pile up as
+     * differences that merge() adds to the finished count; edits past
+     * it are simply read with a later slice.
+     */
+    class WordIndex {
+    public:
+        using Counts = std::map<std::string, int, std::less<>>;
+        using Tally = std::unordered_map<std::string, int>;
+
+    private:
+        Counts counts; // occurrences, or changes since the snapshot while counting
+        bool built = false;
+        uint64_t generation = 0; // bumped by reset(), drops the result of older counts
+        size_t sliced = 0; // text before this was handed out as slices; npos once all of it was
+        size_t removed = 0; // length of the range passed to before_edit()
+
+        static constexpr size_t MIN_WORD_LENGTH = 3;
+        static constexpr size_t MAX_WORD_LENGTH = 64;
+        static constexpr size_t COUNT_SLICE = 1 << 20; // bytes copied for the count at a time
+        static constexpr size_t MAX_SCANNED_WORDS = 20000; // per completion, bounds short prefixes
+
+        static std::pair<size_t, size_t> around(const std::string& text, size_t begin, size_t end);
+        static void for_each_word(const std::string& text, size_t begin, size_t end, const std::function<void(std::string_view)>& visit);
+        void add_words(const std::string& text, size_t begin, size_t end, int delta);
+
+    public:
+        static bool is_word_char(char ch);
+        static void count(const std::string& slice, Tally& tally);
+        static Counts sort(Tally&& tally);
+
+        uint64_t reset();
+        std::string next_slice(const std::string& text);
+        bool merge(Counts&& fresh, uint64_t count_generation);
+        bool ready() const;
+        void before_edit(const std::string& text, size_t begin, size_t end);
+        void after_edit(const std::string& text, size_t begin, size_t end);
+        std::vector<std::string> complete(std::string_view prefix, size_t limit) const;
+
+    };
+}
+
+#endif
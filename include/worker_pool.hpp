@@ -0,0 +1,48 @@
+#ifndef WORKER_POOL
+#define WORKER_POOL
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Var {
+
+    /**
+     * Fixed-size pool of background threads
+     *
+     * Threads are started on the first submit(), so programs that never
+     * use background work don't pay for them. Jobs run in FIFO order;
+     * the destructor finishes queued jobs and joins all threads.
+     *
+     * parallel_for() blocks the caller and must not be used from a
+     * job running on the same pool.
+     */
+    class WorkerPool {
+    private:
+        std::vector<std::thread> threads;
+        std::deque<std::function<void()>> jobs;
+        std::mutex jobs_mutex;
+        std::condition_variable jobs_ready;
+        size_t thread_count;
+        bool stopping = false;
+
+        void start();
+        void work();
+
+    public:
+        explicit WorkerPool(size_t thread_count = 0);
+        ~WorkerPool();
+        WorkerPool(const WorkerPool&) = delete;
+        WorkerPool& operator=(const WorkerPool&) = delete;
+
+        void submit(std::function<void()> job);
+        void parallel_for(size_t count, size_t grain, const std::function<void(size_t, size_t)>& body);
+        size_t size() const;
+
+    };
+}
+
+#endif
@@ -23,15 +23,22 @@ ArgumentParser::ArgumentParser(int argc, char** argv) : argc(argc), argv(argv) {
  * Displays usage message if no arguments are provided.
  * 
  * Flow:
- * 1. Processes all command line options using getopt()
+ * 1. Processes all command line options using getopt_long()
  * 2. Stores non-option arguments in member vector 'vec'
  * 3. Returns true if files were specified, false otherwise
  */
 
 bool ArgumentParser::parse() {
     int opt; //current options
+    static const option long_options[] = {
+        {"help", no_argument, nullptr, 'h'},
+        {"version", no_argument, nullptr, 'V'},
+        {"batch", required_argument, nullptr, 'b'},
+        {"follow", no_argument, nullptr, 'f'},
+        {nullptr, 0, nullptr, 0}
+    };
     
-    while ((opt = getopt(argc, argv, "hV")) != -1) {
+    while ((opt = getopt_long(argc, argv, "hVb:f", long_options, nullptr)) != -1) {
         switch (opt) {
             case 'h':
                 print_help();
@@ -39,6 +46,12 @@ bool ArgumentParser::parse() {
             case 'V':
                 print_version();
                 break;
+            case 'b':
+                batch_script = optarg;
+                break;
+            case 'f':
+                follow = true;
+                break;
             default:
                 std::cerr << "Unknown argument. Use -h for help.\n";
                 break;
@@ -47,7 +60,9 @@ bool ArgumentParser::parse() {
 
     for (int i = optind; i < argc; i++) {
         vec.push_back(argv[i]);
-        std::cout << argv[i] << std::endl; 
+        if (batch_script.empty()) {
+            std::cout << argv[i] << std::endl; 
+        }
     }
 
     if (vec.size() > 0) {
@@ -62,7 +77,11 @@ void ArgumentParser::print_help() {
               << "Edit text files.\n"
               << "Options:\n"
               << "  -h, --help     display this help and exit\n"
-              << "  -V, --version  show program version and exit\n";
+              << "  -V, --version  show program version and exit\n"
+              << "  -b, --batch SCRIPT\n"
+              << "                 apply the edits in SCRIPT to every FILE without\n"
+              << "                 opening the editor (files are processed in parallel)\n"
+              << "  -f, --follow   keep reading what other programs append to FILE\n";
 }
 
 void ArgumentParser::print_version() {
@@ -0,0 +1,253 @@
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <filesystem>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "batch.hpp"
+#include "worker_pool.hpp"
+
+namespace fs = std::filesystem;
+
+namespace Var {
+
+    namespace {
+        // Splits "/a/b/" style fields after the command letter; a backslash
+        // before the delimiter makes it literal, other escapes are kept
+        std::vector<std::string> split_fields(const std::string& line, size_t start, char delimiter) {
+            std::vector<std::string> fields(1);
+            for (size_t i = start; i < line.size(); ++i) {
+                if (line[i] == '\\' && i + 1 < line.size() && line[i + 1] == delimiter) {
+                    fields.back() += delimiter;
+                    ++i;
+                } else if (line[i] == delimiter) {
+                    fields.emplace_back();
+                } else {
+                    fields.back() += line[i];
+                }
+            }
+            return fields;
+        }
+
+        // For every path, the index of the first one naming the same
+        // file; only those are edited, so no two workers write one file
+        // and overwrite each other's result
+        std::vector<size_t> first_of_same(const std::vector<std::string>& files) {
+            std::vector<size_t> first(files.size());
+            std::unordered_map<std::string, size_t> seen;
+            for (size_t i = 0; i < files.size(); ++i) {
+                std::error_code error;
+                const fs::path resolved = fs::weakly_canonical(files[i], error);
+                first[i] = seen.try_emplace(error ? files[i] : resolved.string(), i).first->second;
+            }
+            return first;
+        }
+    }
+
+    /**
+     * Reads and compiles the script
+     *
+     * Throws std::runtime_error naming the script line on syntax errors,
+     * before any file is touched.
+     */
+    BatchEditor::BatchEditor(const std::string& script_path) {
+        std::ifstream script(script_path);
+        if (!script) {
+            throw std::runtime_error("Unable to open script: " + script_path);
+        }
+
+        std::string line;
+        int line_number = 0;
+        while (std::getline(script, line)) {
+            ++line_number;
+            if (line.empty() || line[0] == '#') continue;
+            commands.push_back(parse_command(line, line_number));
+        }
+    }
+
+    BatchCommand BatchEditor::parse_command(const std::string& line, int line_number) {
+        const std::string where = "script line " + std::to_string(line_number) + ": ";
+        BatchCommand command;
+
+        try {
+            if ((line[0] == 's' || line[0] == 'd') && line.size() > 1) {
+                const std::vector<std::string> fields = split_fields(line, 2, line[1]);
+                if (line[0] == 's') {
+                    if (fields.size() != 3 || (fields[2] != "" && fields[2] != "g")) {
+                        throw std::runtime_error("expected s/pattern/replacement/[g]");
+                    }
+                    command.kind = BatchCommand::Kind::Substitute;
+                    command.text = fields[1];
+                    command.global = fields[2] == "g";
+                } else {
+                    if (fields.size() != 2 || !fields[1].empty()) {
+                        throw std::runtime_error("expected d/pattern/");
+                    }
+                    command.kind = BatchCommand::Kind::Delete;
+                }
+                command.pattern = std::regex(fields[0], std::regex::ECMAScript | std::regex::optimize);
+            } else if (line[0] == 'i' && line.size() > 2 && line[1] == ' ') {
+                const size_t number_end = line.find(' ', 2);
+                const std::string position = line.substr(2, number_end - 2);
+                command.kind = BatchCommand::Kind::Insert;
+                command.line = position == "$" ? 0 : std::stoi(position);
+                command.text = number_end == std::string::npos ? "" : line.substr(number_end + 1);
+                if (position != "$" && command.line <= 0) {
+                    throw std::runtime_error("line number must be positive");
+                }
+            } else {
+                throw std::runtime_error("unknown command");
+            }
+        } catch (const std::regex_error& e) {
+            throw std::runtime_error(where + "bad pattern: " + e.what());
+        } catch (const std::logic_error& e) {
+            throw std::runtime_error(where + "bad line number");
+        } catch (const std::runtime_error& e) {
+            throw std::runtime_error(where + e.what());
+        }
+        return command;
+    }
+
+    /**
+     * Processes all files and prints per-file timing
+     *
+     * Output keeps argument order regardless of completion order. A
+     * file listed again, under any path, is processed only once and
+     * reported as skipped where it repeats.
+     * Returns the process exit status: 0 when every file succeeded.
+     */
+    int BatchEditor::run(const std::vector<std::string>& files) const {
+        const auto started = std::chrono::steady_clock::now();
+        const std::vector<size_t> first = first_of_same(files);
+        std::vector<Result> results(files.size());
+
+        std::mutex done_mutex;
+        std::condition_variable all_done;
+        size_t remaining = 0;
+        for (size_t i = 0; i < files.size(); ++i) {
+            if (first[i] == i) ++remaining;
+        }
+        {
+            WorkerPool pool;
+            for (size_t i = 0; i < files.size(); ++i) {
+                if (first[i] != i) continue;
+                pool.submit([&, i] {
+                    Result result = process(files[i]);
+
+                    std::lock_guard<std::mutex> lock(done_mutex);
+                    results[i] = std::move(result);
+                    if (--remaining == 0) all_done.notify_one();
+                });
+            }
+
+            std::unique_lock<std::mutex> lock(done_mutex);
+            all_done.wait(lock, [&] { return remaining == 0; });
+        }
+
+        int failures = 0;
+        size_t skipped = 0;
+        for (size_t i = 0; i < files.size(); ++i) {
+            if (first[i] != i) {
+                printf("%s: skipped (same file as %s)\n", files[i].c_str(), files[first[i]].c_str());
+                ++skipped;
+                continue;
+            }
+
+            const Result& result = results[i];
+            if (!result.error.empty()) {
+                std::cerr << files[i] << ": error: " << result.error << "\n";
+                ++failures;
+                continue;
+            }
+            printf("%s: %zu edit%s, %.2f ms\n", files[i].c_str(), result.edits,
+                   result.edits == 1 ? "" : "s", result.milliseconds);
+        }
+
+        const std::chrono::duration<double, std::milli> total = std::chrono::steady_clock::now() - started;
+        printf("%zu file%s, %d failed, %zu skipped, %.2f ms total\n", files.size(),
+               files.size() == 1 ? "" : "s", failures, skipped, total.count());
+        return failures > 0 ? 1 : 0;
+    }
+
+    BatchEditor::Result BatchEditor::process(const std::string& path) const {
+        const auto started = std::chrono::steady_clock::now();
+        Result result;
+
+        try {
+            Buffer buffer;
+            std::string filename;
+            buffer.load_file(path, filename);
+
+            result.edits = apply(buffer);
+            if (result.edits > 0) {
+                buffer.save_file_atomic(path);
+            }
+        } catch (const std::exception& e) {
+            result.error = e.what();
+        }
+
+        const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - started;
+        result.milliseconds = elapsed.count();
+        return result;
+    }
+
+    size_t BatchEditor::apply(Buffer& buffer) const {
+        size_t edits = 0;
+        for (const BatchCommand& command : commands) {
+            if (command.kind == BatchCommand::Kind::Insert) {
+                const int line = command.line == 0 ? buffer.line_count() : command.line - 1;
+                buffer.insert_line(line, command.text);
+                ++edits;
+            } else {
+                edits += apply_to_lines(buffer, command);
+            }
+        }
+        return edits;
+    }
+
+    /**
+     * Runs a substitute or delete command over every line
+     *
+     * Builds the new text in one pass and swaps it in, rather than
+     * editing line by line, so a command costs O(file size).
+     */
+    size_t BatchEditor::apply_to_lines(Buffer& buffer, const BatchCommand& command) const {
+        const std::string& text = buffer.get_text();
+        const bool trailing_newline = !text.empty() && text.back() == '\n';
+        const auto flags = command.global ? std::regex_constants::format_default
+                                          : std::regex_constants::format_first_only;
+
+        std::string output;
+        output.reserve(text.size());
+        size_t edits = 0;
+        bool first = true;
+
+        for (int i = 0; i < buffer.line_count(); ++i) {
+            const std::string_view line = buffer.get_line(i);
+
+            if (command.kind == BatchCommand::Kind::Delete) {
+                if (std::regex_search(line.begin(), line.end(), command.pattern)) {
+                    ++edits;
+                    continue;
+                }
+                if (!first) output += '\n';
+                output.append(line);
+            } else {
+                if (!first) output += '\n';
+                const size_t before = output.size();
+                std::regex_replace(std::back_inserter(output), line.begin(), line.end(),
+                                   command.pattern, command.text, flags);
+                if (std::string_view(output).substr(before) != line) ++edits;
+            }
+            first = false;
+        }
+
+        if (edits == 0) return 0;
+        if (trailing_newline && !output.empty()) output += '\n';
+        buffer.replace_text(std::move(output));
+        return edits;
+    }
+}
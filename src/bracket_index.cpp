@@ -0,0 +1,498 @@
+#include <algorithm>
+#include <string_view>
+
+#include "bracket_index.hpp"
+
+namespace Var {
+
+    namespace {
+        // Depth change of the character at pos, which is consumed
+        // together with the character it escapes inside a string
+        int step(const std::string& text, size_t& pos, bool& quoted) {
+            const char ch = text[pos++];
+            if (quoted) {
+                if (ch == '\\' && pos < text.size() && text[pos] != '\n') {
+                    ++pos;
+                } else if (ch == '"' || ch == '\n') {
+                    quoted = false;
+                }
+                return 0;
+            }
+            switch (ch) {
+                case '"':
+                    quoted = true;
+                    return 0;
+                case '{': case '[': case '(':
+                    return 1;
+                case '}': case ']': case ')':
+                    return -1;
+                default:
+                    return 0;
+            }
+        }
+
+        bool is_opener(char ch) {
+            return ch == '{' || ch == '[' || ch == '(';
+        }
+
+        // Characters step() has to look at, outside and inside strings
+        struct SpecialTable {
+            bool plain[256] = {};
+            bool quoted[256] = {};
+
+            SpecialTable() {
+                for (const unsigned char ch : std::string_view("{[()]}\"\n")) plain[ch] = true;
+                for (const unsigned char ch : std::string_view("\"\\\n")) quoted[ch] = true;
+            }
+        };
+        const SpecialTable special;
+    }
+
+    /**
+     * Copies the next BUILD_GRAIN bytes or so of the buffer for
+     * scan_slice(), ending at a line break; once all of it was scanned
+     * the index is finished instead and false returned
+     */
+    bool BracketIndex::next_slice(const Buffer& buffer, Slice& slice) {
+        if (built) return false;
+
+        const std::string& text = buffer.get_text();
+        if (scanned_bytes >= text.size()) {
+            blocks = std::move(scanned);
+            scanned = {};
+            if (blocks.empty()) {
+                blocks.push_back({0, 0, 0, 0});
+            }
+            rebuild_tree();
+            built = true;
+            return false;
+        }
+
+        size_t end = text.size();
+        if (sliced + BUILD_GRAIN < text.size()) {
+            const size_t newline = text.find('\n', sliced + BUILD_GRAIN);
+            if (newline != std::string::npos) end = newline + 1;
+        }
+        slice.text = text.substr(sliced, end - sliced);
+        slice.blocks.clear();
+        slice.ticket = slice_ticket;
+        sliced = end;
+        text_size = text.size();
+        return true;
+    }
+
+    /**
+     * Scans a slice on a worker thread; the slice starts outside a string
+     */
+    void BracketIndex::scan_slice(Slice& slice) {
+        scan(slice.text, 0, slice.text.size(), slice.blocks);
+        slice.text = {};
+    }
+
+    /**
+     * Appends the blocks of a scanned slice, unless an edit dropped it
+     */
+    void BracketIndex::add_slice(Slice&& slice) {
+        if (built || slice.ticket != slice_ticket) return;
+        scanned.insert(scanned.end(), slice.blocks.begin(), slice.blocks.end());
+        scanned_bytes = sliced;
+    }
+
+    bool BracketIndex::ready() const {
+        return built;
+    }
+
+    /**
+     * Reports an edit that replaced old_count lines starting at
+     * first_line
+     *
+     * changed_from, if known, is the first byte the edit touched (the
+     * old size for appended text), so only the blocks from there on
+     * are rescanned rather than all of a long first line. The tree is
+     * only rebuilt when blocks added at the end run out of spare leaves,
+     * or a merged block in the middle would grow too large.
+     *
+     * While building, the new lines (new_count of them) locate the end
+     * of the edit; see edit_while_building().
+     */
+    void BracketIndex::lines_changed(const Buffer& buffer, int first_line, int old_count, int new_count, size_t changed_from) {
+        const std::string& text = buffer.get_text();
+        first_line = std::clamp(first_line, 0, buffer.line_count() - 1);
+        if (!built) {
+            const int last_line = std::clamp(first_line + new_count - 1, first_line, buffer.line_count() - 1);
+            edit_while_building(buffer, std::max(buffer.line_offset(first_line), changed_from), last_line);
+            return;
+        }
+
+        const size_t first_block = block_at_offset(std::max(buffer.line_offset(first_line), changed_from));
+        size_t last_block = std::max(first_block, block_at_line(first_line + std::max(old_count, 1) - 1));
+
+        // Text after the last block only moved by the size difference.
+        // A block cut inside a line may now start inside a string, so
+        // the rescan goes on to the end of that line.
+        const size_t begin = prefix(first_block).bytes;
+        const size_t old_end = prefix(last_block).bytes + blocks[last_block].bytes;
+        size_t end = old_end + text.size() - tree[1].bytes;
+        while (last_block + 1 < blocks.size() && end > 0 && text[end - 1] != '\n') {
+            ++last_block;
+            end += blocks[last_block].bytes;
+        }
+
+        std::vector<Summary> fresh;
+        scan(text, begin, end, fresh);
+        if (fresh.empty()) {
+            fresh.push_back({0, 0, 0, 0});
+        }
+
+        // At the end blocks come and go in the spare leaves
+        if (last_block + 1 == blocks.size()) {
+            const size_t old_blocks = blocks.size();
+            blocks.resize(first_block);
+            blocks.insert(blocks.end(), fresh.begin(), fresh.end());
+            if (blocks.size() > leaves) {
+                rebuild_tree();
+                return;
+            }
+            for (size_t block = first_block; block < std::max(old_blocks, blocks.size()); ++block) {
+                update_leaf(block);
+            }
+            return;
+        }
+
+        // In the middle the replaced leaves are reused: surplus blocks
+        // are merged into the last one, missing ones stay empty
+        const size_t replaced = last_block - first_block + 1;
+        if (fresh.size() > replaced) {
+            Summary merged = fresh[replaced - 1];
+            for (size_t i = replaced; i < fresh.size(); ++i) {
+                merged = combine(merged, fresh[i]);
+            }
+            if (merged.bytes > MAX_BLOCK_BYTES) {
+                blocks.erase(blocks.begin() + first_block, blocks.begin() + last_block + 1);
+                blocks.insert(blocks.begin() + first_block, fresh.begin(), fresh.end());
+                rebuild_tree();
+                return;
+            }
+            fresh.resize(replaced);
+            fresh.back() = merged;
+        }
+        fresh.resize(replaced, Summary{});
+
+        for (size_t i = 0; i < replaced; ++i) {
+            blocks[first_block + i] = fresh[i];
+            update_leaf(first_block + i);
+        }
+    }
+
+    /**
+     * Position of the bracket matching the one at pos, NONE if pos is
+     * not on a bracket (or inside a string) or the bracket is unmatched
+     */
+    size_t BracketIndex::match(const Buffer& buffer, size_t pos) const {
+        if (!built) return NONE;
+
+        const auto [depth, bracket] = inspect(buffer, pos);
+        if (bracket == 0) return NONE;
+
+        if (is_opener(bracket)) {
+            // The closer is where the depth first falls back
+            const size_t after = first_at_most(buffer, pos + 1, depth);
+            return after == NONE ? NONE : after - 1;
+        }
+        // The opener is where the depth last rose to the closer's level
+        return last_at_most(buffer, pos, depth - 1);
+    }
+
+    /**
+     * Position of the opening bracket enclosing pos, NONE at top level
+     */
+    size_t BracketIndex::parent(const Buffer& buffer, size_t pos) const {
+        if (!built) return NONE;
+        return last_at_most(buffer, pos, inspect(buffer, pos).first - 1);
+    }
+
+    BracketIndex::Summary BracketIndex::combine(const Summary& a, const Summary& b) {
+        Summary sum;
+        sum.bytes = a.bytes + b.bytes;
+        sum.newlines = a.newlines + b.newlines;
+        sum.net = a.net + b.net;
+        sum.min = b.min == EMPTY ? a.min : std::min(a.min, a.net + b.min);
+        return sum;
+    }
+
+    /**
+     * Applies an edit from byte from to the end of last_line to the
+     * index being built
+     *
+     * Edits past the text handed out are read with a later slice. In
+     * the scanned text the blocks around the edit are rescanned, the
+     * slice in flight only moves. An edit reaching into that slice drops
+     * it, and the scanned blocks from the edit on with it; so does text
+     * appended to a last slice that ended inside a line, and so perhaps
+     * inside a string.
+     */
+    void BracketIndex::edit_while_building(const Buffer& buffer, size_t from, int last_line) {
+        const std::string& text = buffer.get_text();
+        const size_t old_size = text_size;
+        text_size = text.size();
+        if (from > sliced || (from == sliced && (sliced == 0 || text[sliced - 1] == '\n'))) return;
+
+        // End of the edited lines before the edit, a line break
+        const size_t new_end = last_line + 1 < buffer.line_count() ? buffer.line_offset(last_line + 1) : text.size();
+        const size_t edit_end = new_end + old_size - text.size();
+        if (from >= scanned_bytes || edit_end > scanned_bytes) {
+            ++slice_ticket;
+            size_t kept = 0;
+            size_t bytes = 0;
+            while (kept < scanned.size() && bytes + scanned[kept].bytes <= from) {
+                bytes += scanned[kept++].bytes;
+            }
+            scanned.resize(kept);
+            scanned_bytes = sliced = bytes;
+            return;
+        }
+
+        size_t first_block = 0;
+        size_t begin = 0;
+        while (begin + scanned[first_block].bytes <= from) {
+            begin += scanned[first_block++].bytes;
+        }
+        size_t last_block = first_block;
+        size_t end = begin + scanned[first_block].bytes; // before the edit
+        while (end < edit_end) {
+            end += scanned[++last_block].bytes;
+        }
+
+        // As in lines_changed(), blocks cut inside a line are rescanned
+        // up to its end
+        end = end + text.size() - old_size;
+        while (last_block + 1 < scanned.size() && end > begin && text[end - 1] != '\n') {
+            ++last_block;
+            end += scanned[last_block].bytes;
+        }
+
+        std::vector<Summary> fresh;
+        scan(text, begin, end, fresh);
+        scanned.erase(scanned.begin() + first_block, scanned.begin() + last_block + 1);
+        scanned.insert(scanned.begin() + first_block, fresh.begin(), fresh.end());
+        scanned_bytes = scanned_bytes + text.size() - old_size;
+        sliced = sliced + text.size() - old_size;
+    }
+
+    /**
+     * Summarizes text[begin, end) into blocks, closing one at the
+     * first line break after BLOCK_BYTES, or after MAX_BLOCK_BYTES at
+     * the first character outside a string
+     */
+    void BracketIndex::scan(const std::string& text, size_t begin, size_t end, std::vector<Summary>& out) {
+        Summary block;
+        block.min = 0;
+        size_t block_start = begin;
+        bool quoted = false;
+
+        auto close_block = [&](size_t pos) {
+            block.bytes = pos - block_start;
+            out.push_back(block);
+            block = Summary{0, 0, 0, 0};
+            block_start = pos;
+        };
+
+        for (size_t pos = begin; pos < end;) {
+            // Runs of ordinary characters change nothing, but outside
+            // strings they may not run past the block size limit
+            const bool* interesting = quoted ? special.quoted : special.plain;
+            const size_t limit = quoted ? end : std::min(end, std::max(pos, block_start + MAX_BLOCK_BYTES));
+            while (pos < limit && !interesting[static_cast<unsigned char>(text[pos])]) ++pos;
+            if (pos == end) break;
+            if (!quoted && pos - block_start >= MAX_BLOCK_BYTES) {
+                close_block(pos);
+                continue;
+            }
+
+            const bool newline = text[pos] == '\n';
+            block.net += step(text, pos, quoted);
+            block.min = std::min(block.min, block.net);
+
+            if (newline) {
+                ++block.newlines;
+                if (pos - block_start >= BLOCK_BYTES) {
+                    close_block(pos);
+                }
+            }
+        }
+
+        if (end > block_start) {
+            block.bytes = end - block_start;
+            out.push_back(block);
+        }
+    }
+
+    void BracketIndex::rebuild_tree() {
+        leaves = 1;
+        while (leaves < blocks.size()) leaves *= 2;
+
+        tree.assign(2 * leaves, Summary{});
+        std::copy(blocks.begin(), blocks.end(), tree.begin() + leaves);
+        for (size_t node = leaves - 1; node >= 1; --node) {
+            tree[node] = combine(tree[2 * node], tree[2 * node + 1]);
+        }
+    }
+
+    // Refreshes the leaf of block, a spare leaf past the last block
+    void BracketIndex::update_leaf(size_t block) {
+        size_t node = leaves + block;
+        tree[node] = block < blocks.size() ? blocks[block] : Summary{};
+        for (node /= 2; node >= 1; node /= 2) {
+            tree[node] = combine(tree[2 * node], tree[2 * node + 1]);
+        }
+    }
+
+    /**
+     * Sum of all blocks before block: its offset, first line and
+     * starting depth
+     */
+    BracketIndex::Summary BracketIndex::prefix(size_t block) const {
+        Summary sum{0, 0, 0, 0};
+        for (size_t node = leaves + block; node > 1; node /= 2) {
+            if (node % 2 == 1) {
+                sum = combine(tree[node - 1], sum);
+            }
+        }
+        return sum;
+    }
+
+    size_t BracketIndex::block_at_offset(size_t pos) const {
+        size_t node = 1;
+        while (node < leaves) {
+            if (pos < tree[2 * node].bytes) {
+                node = 2 * node;
+            } else {
+                pos -= tree[2 * node].bytes;
+                node = 2 * node + 1;
+            }
+        }
+        return std::min(node - leaves, blocks.size() - 1);
+    }
+
+    /**
+     * Block holding the newline that ends line (the last block for the
+     * last line), which is where an edit of the line ends
+     */
+    size_t BracketIndex::block_at_line(int line) const {
+        size_t node = 1;
+        while (node < leaves) {
+            if (line < tree[2 * node].newlines) {
+                node = 2 * node;
+            } else {
+                line -= tree[2 * node].newlines;
+                node = 2 * node + 1;
+            }
+        }
+        return std::min(node - leaves, blocks.size() - 1);
+    }
+
+    /**
+     * First block at or after from whose depth reaches limit or below,
+     * -1 if there is none; depth is the depth at the start of node
+     */
+    int BracketIndex::find_forward(size_t node, size_t lo, size_t hi, size_t from, int depth, int limit) const {
+        if (hi <= from || depth + tree[node].min > limit) return -1;
+        if (hi - lo == 1) return static_cast<int>(lo);
+
+        const size_t mid = (lo + hi) / 2;
+        const int found = find_forward(2 * node, lo, mid, from, depth, limit);
+        if (found >= 0) return found;
+        return find_forward(2 * node + 1, mid, hi, from, depth + tree[2 * node].net, limit);
+    }
+
+    /**
+     * Last block at or before to whose depth reaches limit or below
+     */
+    int BracketIndex::find_backward(size_t node, size_t lo, size_t hi, size_t to, int depth, int limit) const {
+        if (lo > to || depth + tree[node].min > limit) return -1;
+        if (hi - lo == 1) return static_cast<int>(lo);
+
+        const size_t mid = (lo + hi) / 2;
+        const int found = find_backward(2 * node + 1, mid, hi, to, depth + tree[2 * node].net, limit);
+        if (found >= 0) return found;
+        return find_backward(2 * node, lo, mid, to, depth, limit);
+    }
+
+    /**
+     * First position at or after from where the depth is limit or less
+     */
+    size_t BracketIndex::first_at_most(const Buffer& buffer, size_t from, int limit) const {
+        const std::string& text = buffer.get_text();
+
+        // Rest of the block holding from, then the first block the tree
+        // says gets low enough
+        size_t block = block_at_offset(from);
+        for (int pass = 0; pass < 2; ++pass) {
+            const Summary before = prefix(block);
+            const size_t end = before.bytes + blocks[block].bytes;
+            size_t pos = before.bytes;
+            int depth = before.net;
+            bool quoted = false;
+            while (true) {
+                if (pos >= from && depth <= limit) return pos;
+                if (pos >= end) break;
+                depth += step(text, pos, quoted);
+            }
+
+            const int next = find_forward(1, 0, leaves, block + 1, 0, limit);
+            if (next < 0) break;
+            block = static_cast<size_t>(next);
+        }
+        return NONE;
+    }
+
+    /**
+     * Last position at or before to where the depth is limit or less
+     */
+    size_t BracketIndex::last_at_most(const Buffer& buffer, size_t to, int limit) const {
+        const std::string& text = buffer.get_text();
+
+        size_t block = block_at_offset(to);
+        for (int pass = 0; pass < 2; ++pass) {
+            const Summary before = prefix(block);
+            const size_t end = std::min(before.bytes + blocks[block].bytes, to);
+            size_t pos = before.bytes;
+            int depth = before.net;
+            bool quoted = false;
+            size_t found = NONE;
+            while (true) {
+                if (depth <= limit) found = pos;
+                if (pos >= end) break;
+                depth += step(text, pos, quoted);
+            }
+            if (found != NONE) return found;
+
+            const int previous = block > 0 ? find_backward(1, 0, leaves, block - 1, 0, limit) : -1;
+            if (previous < 0) break;
+            block = static_cast<size_t>(previous);
+        }
+        return NONE;
+    }
+
+    /**
+     * Depth at pos, and the bracket at pos if it is one outside a
+     * string (else 0)
+     */
+    std::pair<int, char> BracketIndex::inspect(const Buffer& buffer, size_t pos) const {
+        const std::string& text = buffer.get_text();
+        const size_t block = block_at_offset(pos);
+        const Summary before = prefix(block);
+
+        size_t at = before.bytes;
+        int depth = before.net;
+        bool quoted = false;
+        while (at < pos) {
+            depth += step(text, at, quoted);
+        }
+
+        if (at > pos || quoted || pos >= text.size()) return {depth, 0};
+        const char ch = text[pos];
+        const bool bracket = is_opener(ch) || ch == '}' || ch == ']' || ch == ')';
+        return {depth, bracket ? ch : 0};
+    }
+}
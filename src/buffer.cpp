@@ -1,8 +1,11 @@
 #include <ncurses.h>
+#include <unistd.h>
+#include <sys/stat.h>
 #include <string>
 #include <vector>
 #include <sstream>
 #include <fstream>
+#include <cstdlib>
 #include <cstring>
 #include <algorithm>
 
@@ -10,10 +13,10 @@
 
 namespace Var {
 
-    void Buffer::load_file(const std::string& file_path, std::string& filename) {
+    void Buffer::load_file(const std::string& file_path, std::string& filename, std::vector<size_t> known_offsets) {
         reset_buffer_state();
         try {
-            load_and_process_file(file_path, filename);
+            load_and_process_file(file_path, filename, std::move(known_offsets));
         } catch (const std::exception& e) {
             handle_load_error(filename);
             throw;
@@ -22,28 +25,47 @@ namespace Var {
 
     void Buffer::reset_buffer_state() {
         text.clear();
-        line_offsets.clear();
+        line_index.clear();
+        ++edit_revision;
     }
     
-    void Buffer::load_and_process_file(const std::string& file_path, std::string& filename) {
-        load_file_content(file_path);
+    void Buffer::load_and_process_file(const std::string& file_path, std::string& filename, std::vector<size_t>&& known_offsets) {
+        load_file_content(file_path, std::move(known_offsets));
         filename = file_path;
         ensure_minimum_buffer_state();
     }
     
-    void Buffer::load_file_content(const std::string& file_path) {
+    void Buffer::load_file_content(const std::string& file_path, std::vector<size_t>&& known_offsets) {
         text = read_file_to_string(file_path);
-        build_line_index();
+
+        // A cached index is only adopted if it still fits the text: every
+        // line but the first starts after a newline and the last has none
+        // inside it
+        bool fits = !known_offsets.empty() && known_offsets.front() == 0 &&
+            (known_offsets.size() == 1 || known_offsets.back() < text.size());
+        for (size_t i = 1; fits && i < known_offsets.size(); ++i) {
+            fits = known_offsets[i] > known_offsets[i - 1] && text[known_offsets[i] - 1] == '\n';
+        }
+        if (fits) {
+            const size_t newline = text.find('\n', known_offsets.back());
+            fits = newline == std::string::npos || newline + 1 == text.size();
+        }
+
+        if (fits) {
+            line_index.assign(std::move(known_offsets));
+        } else {
+            build_line_index();
+        }
     }
     
     void Buffer::ensure_minimum_buffer_state() {
-        if (line_offsets.empty()) {
+        if (line_index.empty()) {
             initialize_with_empty_line();
         }
     }
     
     void Buffer::initialize_with_empty_line() {
-        line_offsets.push_back(0);
+        line_index.push_back(0);
         text = "";
     }
     
@@ -78,6 +100,49 @@ namespace Var {
         file.close();
     }
     
+    // Writes a temporary file next to filename, fsyncs it and renames it
+    // over the original, keeping its permission bits and owner. A
+    // symlink is followed, so the file it points to is the one replaced.
+    void Buffer::save_file_atomic(const std::string& filename) const {
+        if (filename.empty()) {
+            throw std::runtime_error("No filename provided");
+        }
+
+        std::string target = filename;
+        if (char* resolved = realpath(filename.c_str(), nullptr)) {
+            target = resolved;
+            free(resolved);
+        }
+
+        std::string temporary = target + ".var-XXXXXX";
+        const int fd = mkstemp(temporary.data());
+        if (fd < 0) {
+            throw std::runtime_error("Failed to create temporary file for: " + filename);
+        }
+
+        struct stat info;
+        if (stat(target.c_str(), &info) == 0) {
+            fchmod(fd, info.st_mode & 07777);
+            // Only root may give the file away; the group alone may still be kept
+            if (fchown(fd, info.st_uid, info.st_gid) != 0 && fchown(fd, static_cast<uid_t>(-1), info.st_gid) != 0) {
+                // Owned by whoever saved it, as with any new file
+            }
+        }
+
+        size_t written = 0;
+        while (written < text.size()) {
+            const ssize_t chunk = write(fd, text.data() + written, text.size() - written);
+            if (chunk < 0) break;
+            written += static_cast<size_t>(chunk);
+        }
+
+        const bool ok = written == text.size() && fsync(fd) == 0;
+        if (close(fd) != 0 || !ok || rename(temporary.c_str(), target.c_str()) != 0) {
+            unlink(temporary.c_str());
+            throw std::runtime_error("Failed to write to file: " + filename);
+        }
+    }
+    
     std::string_view Buffer::get_line(int line_number) const {
         if (is_invalid_line(line_number)) {
             return "";
@@ -88,15 +153,73 @@ namespace Var {
     }
     
     int Buffer::line_count() const {
-        return static_cast<int>(line_offsets.size());
+        return static_cast<int>(line_index.size());
     }
     
     void Buffer::insert_char(int line, int col, char ch) {
         const size_t pos = calculate_absolute_position(line, col);
         text.insert(text.begin() + pos, ch);
         update_line_index_from(pos);
+        ++edit_revision;
+    }
+    
+    // Inserts content as a new line before line; past the end it appends,
+    // keeping whether or not the text ends with a newline
+    void Buffer::insert_line(int line, std::string_view content) {
+        std::string inserted(content);
+        size_t pos;
+        if (line < line_count()) {
+            pos = line_offset(std::max(line, 0));
+            inserted += '\n';
+        } else {
+            pos = text.size();
+            if (text.empty() || text.back() == '\n') {
+                inserted += '\n';
+            } else {
+                inserted.insert(inserted.begin(), '\n');
+            }
+        }
+
+        text.insert(pos, inserted);
+        // Rescan from the previous newline, which may now gain a next line
+        update_line_index_from(pos > 0 ? pos - 1 : 0);
+        ++edit_revision;
+    }
+
+    void Buffer::replace_text(std::string&& new_text) {
+        text = std::move(new_text);
+        build_line_index();
+        ++edit_revision;
     }
     
+    // Adds text at the end, indexing only the newly arrived lines
+    void Buffer::append(std::string_view chunk) {
+        if (chunk.empty()) return;
+
+        const size_t start = text.size();
+        text.append(chunk);
+        // A trailing newline only starts a line once something follows it
+        if (start > 0 && text[start - 1] == '\n') {
+            line_index.push_back(start);
+        }
+        scan_for_newlines(start);
+        ++edit_revision;
+    }
+    
+    // Inserts content at offset pos, e.g. the rest of a completed word
+    void Buffer::insert(size_t pos, std::string_view content) {
+        text.insert(pos, content);
+        update_line_index_from(pos);
+        ++edit_revision;
+    }
+
+    // Removes text[begin, end), e.g. a selection spanning lines
+    void Buffer::erase(size_t begin, size_t end) {
+        text.erase(begin, end - begin);
+        update_line_index_from(begin);
+        ++edit_revision;
+    }
+
     void Buffer::delete_char_before_cursor(int& line, int& col) {
         if (is_at_beginning(line, col)) return;
         
@@ -105,30 +228,49 @@ namespace Var {
         } else {
             handle_line_deletion(line, col);
         }
+        ++edit_revision;
     }
     
     const std::string& Buffer::get_text() const {
         return text;
     }
 
+    // Full copy of the line index, e.g. for the on-disk cache
+    std::vector<size_t> Buffer::get_line_offsets() const {
+        return line_index.to_vector(text);
+    }
+
+    size_t Buffer::line_offset(int line) const {
+        return line_index.offset(text, line);
+    }
+
+    bool Buffer::compact_index() const {
+        return line_index.is_compact();
+    }
+
+    uint64_t Buffer::revision() const {
+        return edit_revision;
+    }
+
     void Buffer::build_line_index() {
-        line_offsets = {0};
+        line_index.clear();
+        line_index.push_back(0);
         
         for (size_t i = 0; i < text.size(); ++i) {
             if (text[i] == '\n' && has_next_position(i)) {
-                line_offsets.push_back(i + 1);
+                line_index.push_back(i + 1);
             }
         }
     }
 
     void Buffer::update_line_index_from(size_t pos) {
         const int line = find_line_for_position(pos);
-        line_offsets.resize(line + 1);
+        line_index.truncate(line + 1);
         scan_for_newlines(pos);
     }
 
     bool Buffer::is_invalid_line(int line) const {
-        return line < 0 || static_cast<size_t>(line) >= line_offsets.size();
+        return line < 0 || static_cast<size_t>(line) >= line_index.size();
     }
 
     bool Buffer::is_at_beginning(int line, int col) const {
@@ -140,18 +282,14 @@ namespace Var {
     }
 
     std::pair<size_t, size_t> Buffer::get_line_boundaries(int line) const {
-        const size_t start = line_offsets[line];
+        const size_t start = line_offset(line);
         const size_t end = text.find('\n', start);
         return {start, end != std::string::npos ? end : text.size()};
     }
 
     int Buffer::find_line_for_position(size_t pos) const {
-        int line = 0;
-        while (line + 1 < static_cast<int>(line_offsets.size()) && 
-            line_offsets[line + 1] <= pos) {
-            ++line;
-        }
-        return line;
+        // Offsets are sorted, so the owning line is the last one starting at or before pos
+        return static_cast<int>(line_index.line_of(text, pos));
     }
 
     void Buffer::scan_for_newlines(size_t start_pos) {
@@ -161,7 +299,7 @@ namespace Var {
             if (nl_pos == std::string::npos) break;
             
             if (has_next_position(nl_pos)) {
-                line_offsets.push_back(nl_pos + 1);
+                line_index.push_back(nl_pos + 1);
             }
             pos = nl_pos + 1;
         }
@@ -185,11 +323,11 @@ namespace Var {
     }
 
     size_t Buffer::calculate_absolute_position(int line, int col) const {
-        return line_offsets[line] + col;
+        return line_offset(line) + col;
     }
     
     void Buffer::handle_line_deletion(int& line, int& col) {
-        const size_t prev_line_end = line_offsets[line] - 1;
+        const size_t prev_line_end = line_offset(line) - 1;
         text.erase(text.begin() + prev_line_end);
         update_line_index_from(prev_line_end);
         line--;
@@ -0,0 +1,226 @@
+#include <algorithm>
+
+#include "csv_layout.hpp"
+
+namespace Var {
+
+    /**
+     * Picks the delimiter from the first lines: the candidate that
+     * splits (nearly) all of them into the same number of fields, the
+     * most fields winning. Returns 0 if no candidate gives two or more.
+     */
+    char CsvLayout::detect_delimiter(const Buffer& buffer) {
+        const int lines = std::min(buffer.line_count(), DETECT_LINES);
+        char best = 0;
+        size_t best_fields = 1;
+
+        for (const char candidate : CANDIDATES) {
+            size_t expected = 0;
+            int sampled = 0;
+            int matching = 0;
+            for (int line = 0; line < lines; ++line) {
+                const std::string_view text = buffer.get_line(line);
+                if (text.empty()) continue;
+
+                const size_t fields = split(text, candidate).size();
+                if (sampled++ == 0) expected = fields;
+                if (fields == expected) ++matching;
+            }
+            if (sampled > 0 && matching * 10 >= sampled * 9 && expected > best_fields) {
+                best = candidate;
+                best_fields = expected;
+            }
+        }
+        return best;
+    }
+
+    /**
+     * Splits one line into fields
+     *
+     * A field starting with a quote runs to the matching quote ("" is
+     * an escaped quote), so delimiters inside it don't split.
+     */
+    std::vector<CsvField> CsvLayout::split(std::string_view line, char delimiter) {
+        std::vector<CsvField> fields;
+        const int length = static_cast<int>(line.size());
+        int pos = 0;
+
+        while (true) {
+            CsvField field;
+            field.begin = pos;
+            if (pos < length && line[pos] == '"') {
+                int close = pos + 1;
+                while (close < length) {
+                    if (line[close] == '"') {
+                        if (close + 1 < length && line[close + 1] == '"') {
+                            close += 2;
+                            continue;
+                        }
+                        break;
+                    }
+                    ++close;
+                }
+                field.text_begin = pos + 1;
+                field.text_end = close;
+
+                // Anything between the closing quote and the delimiter is kept in the field
+                pos = std::min(close + 1, length);
+                while (pos < length && line[pos] != delimiter) ++pos;
+            } else {
+                while (pos < length && line[pos] != delimiter) ++pos;
+                field.text_begin = field.begin;
+                field.text_end = pos;
+            }
+            field.end = pos;
+            fields.push_back(field);
+
+            if (pos >= length) break;
+            ++pos; // past the delimiter
+        }
+        return fields;
+    }
+
+    /**
+     * Field holding byte column col; a delimiter belongs to the field
+     * before it
+     */
+    int CsvLayout::field_at(const std::vector<CsvField>& fields, int col) {
+        for (size_t i = 0; i < fields.size(); ++i) {
+            if (col <= fields[i].end) return static_cast<int>(i);
+        }
+        return static_cast<int>(fields.size()) - 1;
+    }
+
+    /**
+     * Text of a field as shown, with doubled quotes of a quoted field
+     * collapsed
+     */
+    std::string CsvLayout::cell_text(std::string_view line, const CsvField& field) {
+        const std::string_view raw = line.substr(field.text_begin, field.text_end - field.text_begin);
+        if (field.text_begin == field.begin) return std::string(raw);
+
+        std::string text;
+        text.reserve(raw.size());
+        for (size_t i = 0; i < raw.size(); ++i) {
+            text += raw[i];
+            if (raw[i] == '"' && i + 1 < raw.size() && raw[i + 1] == '"') ++i;
+        }
+        return text;
+    }
+
+    /**
+     * Detects the delimiter and measures the columns
+     *
+     * Returns false (and stays off) when no delimiter is found.
+     */
+    bool CsvLayout::enable(const Buffer& buffer) {
+        delimiter = detect_delimiter(buffer);
+        if (delimiter == 0) return false;
+
+        widths.clear();
+        first_column = 0;
+
+        const int lines = buffer.line_count();
+        const int head = std::min(lines, HEAD_SAMPLE_LINES);
+        for (int line = 0; line < head; ++line) {
+            sample_line(buffer.get_line(line));
+        }
+        if (lines > head) {
+            const long long rest = lines - head;
+            for (int i = 0; i < SPREAD_SAMPLE_LINES && i < rest; ++i) {
+                sample_line(buffer.get_line(head + static_cast<int>(i * rest / SPREAD_SAMPLE_LINES)));
+            }
+        }
+        for (int& width : widths) {
+            width = std::max(width, 1);
+        }
+        return true;
+    }
+
+    void CsvLayout::disable() {
+        delimiter = 0;
+        widths.clear();
+        first_column = 0;
+    }
+
+    bool CsvLayout::active() const {
+        return delimiter != 0;
+    }
+
+    char CsvLayout::get_delimiter() const {
+        return delimiter;
+    }
+
+    int CsvLayout::column_width(int column) const {
+        return static_cast<size_t>(column) < widths.size() ? widths[column] : DEFAULT_COLUMN_WIDTH;
+    }
+
+    int CsvLayout::get_first_column() const {
+        return first_column;
+    }
+
+    /**
+     * Scrolls horizontally, whole columns at a time, until column fits
+     * into text_width. Returns whether the first column changed.
+     */
+    bool CsvLayout::scroll_to(int column, int text_width) {
+        const int old_first = first_column;
+        if (column < first_column) {
+            first_column = column;
+        }
+
+        int span = column_width(first_column);
+        for (int c = first_column + 1; c <= column; ++c) {
+            span += SEPARATOR_WIDTH + column_width(c);
+        }
+        while (first_column < column && span > text_width) {
+            span -= column_width(first_column) + SEPARATOR_WIDTH;
+            ++first_column;
+        }
+        return first_column != old_first;
+    }
+
+    /**
+     * Screen column (from the text start) showing byte column col of a
+     * line split into fields, -1 when its column is scrolled off
+     *
+     * Bytes cut off at the column width show at the last character; a
+     * delimiter shows on the separator.
+     */
+    int CsvLayout::screen_col(std::string_view line, const std::vector<CsvField>& fields, int col) const {
+        const int field = field_at(fields, col);
+        if (field < first_column) return -1;
+
+        int x = 0;
+        for (int c = first_column; c < field; ++c) {
+            x += column_width(c) + SEPARATOR_WIDTH;
+        }
+
+        const CsvField& cell = fields[field];
+        const int width = column_width(field);
+        if (col >= cell.end) return x + width;
+
+        // Each doubled quote before col shows as one character
+        int shown = col - cell.text_begin;
+        if (cell.text_begin != cell.begin) {
+            for (int i = cell.text_begin; i + 1 < std::min(col, cell.text_end); ++i) {
+                if (line[i] == '"' && line[i + 1] == '"') {
+                    --shown;
+                    ++i;
+                }
+            }
+        }
+        return x + std::clamp(shown, 0, width - 1);
+    }
+
+    void CsvLayout::sample_line(std::string_view line) {
+        const std::vector<CsvField> fields = split(line, delimiter);
+        if (fields.size() > widths.size()) {
+            widths.resize(fields.size(), 0);
+        }
+        for (size_t i = 0; i < fields.size(); ++i) {
+            const int length = static_cast<int>(cell_text(line, fields[i]).size());
+            widths[i] = std::max(widths[i], std::min(length, MAX_COLUMN_WIDTH));
+        }
+    }
+}
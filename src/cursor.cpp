@@ -15,14 +15,15 @@ namespace Var {
         cursor_col = std::clamp(cursor_col, 0, max_col);
     }
     
-    void Cursor::adjust_viewport(const Buffer& buffer, int& viewport_y) const {
-        int rows, cols;
-        getmaxyx(stdscr, rows, cols);
+    // text_rows is the height of the window's text area (without its status bar)
+    void Cursor::adjust_viewport(const Buffer& buffer, const RowIndex& row_index, int& viewport_y, int text_rows) const {
+        text_rows = std::max(text_rows, 1);
+        const int row = visual_row(buffer, row_index);
         
-        if (cursor_line < viewport_y) {
-            viewport_y = cursor_line;
-        } else if (cursor_line >= viewport_y + rows) {
-            viewport_y = cursor_line - rows + 1;
+        if (row < viewport_y) {
+            viewport_y = row;
+        } else if (row >= viewport_y + text_rows) {
+            viewport_y = row - text_rows + 1;
         }
     }
 
@@ -42,18 +43,112 @@ namespace Var {
         }
     }
     
-    void Cursor::move_up(const Buffer& buffer) {
-        if (can_move_up()) {
-            cursor_line--;
-            adjust_col_for_line(buffer);
+    void Cursor::move_up(const Buffer& buffer, const RowIndex& row_index) {
+        if (!row_index.active()) {
+            if (can_move_up()) {
+                cursor_line--;
+                adjust_col_for_line(buffer);
+            }
+            return;
+        }
+
+        // Soft wrap: step one visual row, keeping the on-screen column
+        const int width = row_index.width();
+        const int length = get_current_line_length(buffer);
+        const int segment = std::min(cursor_col / width, length > 0 ? (length - 1) / width : 0);
+        const int x = cursor_col - segment * width;
+        if (segment > 0) {
+            cursor_col = (segment - 1) * width + x;
+        } else if (can_move_up()) {
+            // Previous visible line, stepping over folds
+            cursor_line = row_index.locate(row_index.row_of_line(cursor_line) - 1).first;
+            const int prev_length = get_current_line_length(buffer);
+            const int last_segment = prev_length > 0 ? (prev_length - 1) / width : 0;
+            cursor_col = std::min(last_segment * width + x, prev_length);
         }
     }
     
-    void Cursor::move_down(const Buffer& buffer) {
-        if (can_move_down(buffer)) {
-            cursor_line++;
+    void Cursor::move_down(const Buffer& buffer, const RowIndex& row_index) {
+        if (!row_index.active()) {
+            if (can_move_down(buffer)) {
+                cursor_line++;
+                adjust_col_for_line(buffer);
+            }
+            return;
+        }
+
+        const int width = row_index.width();
+        const int length = get_current_line_length(buffer);
+        const int last_segment = length > 0 ? (length - 1) / width : 0;
+        const int segment = std::min(cursor_col / width, last_segment);
+        const int x = cursor_col - segment * width;
+        if (segment < last_segment) {
+            cursor_col = std::min(cursor_col + width, length);
+            return;
+        }
+
+        // Next visible line: the row right after this line's rows, so a
+        // folded range is skipped in O(log n) however long it is
+        const int next_line = row_index.locate(row_index.row_of_line(cursor_line) + row_index.rows_of(cursor_line)).first;
+        if (next_line < buffer.line_count()) {
+            cursor_line = next_line;
+            cursor_col = std::min(x, get_current_line_length(buffer));
+        }
+    }
+
+    void Cursor::move_page_up(const Buffer& buffer, const RowIndex& row_index, int page_rows) {
+        move_to_visual_row(buffer, row_index, std::max(visual_row(buffer, row_index) - page_rows, 0));
+    }
+
+    void Cursor::move_page_down(const Buffer& buffer, const RowIndex& row_index, int page_rows) {
+        const int last_row = std::max(row_index.total_rows() - 1, 0);
+        move_to_visual_row(buffer, row_index, std::min(visual_row(buffer, row_index) + page_rows, last_row));
+    }
+
+    // Jumps straight to a visual row through the row index, keeping the
+    // on-screen column, so page moves cost O(log n) instead of n single steps
+    void Cursor::move_to_visual_row(const Buffer& buffer, const RowIndex& row_index, int row) {
+        if (!row_index.active()) {
+            cursor_line = std::clamp(row, 0, buffer.line_count() - 1);
             adjust_col_for_line(buffer);
+            return;
         }
+
+        const int width = row_index.width();
+        const int x = cursor_col - (visual_row(buffer, row_index) - row_index.row_of_line(cursor_line)) * width;
+        const auto [line, sub_row] = row_index.locate(row);
+        cursor_line = std::clamp(line, 0, buffer.line_count() - 1);
+        cursor_col = std::min(sub_row * width + x, get_current_line_length(buffer));
+    }
+
+    void Cursor::move_to_line_start() {
+        cursor_col = 0;
+    }
+
+    void Cursor::move_to_line_end(const Buffer& buffer) {
+        cursor_col = get_current_line_length(buffer);
+    }
+
+    void Cursor::move_to_buffer_start() {
+        cursor_line = 0;
+        cursor_col = 0;
+    }
+
+    void Cursor::move_to_buffer_end(const Buffer& buffer) {
+        cursor_line = buffer.line_count() - 1;
+        cursor_col = get_current_line_length(buffer);
+    }
+
+    void Cursor::go_to_line(const Buffer& buffer, int line) {
+        cursor_line = std::clamp(line, 0, buffer.line_count() - 1);
+        cursor_col = 0;
+    }
+
+    void Cursor::go_to_offset(const Buffer& buffer, size_t offset) {
+        offset = std::min(offset, buffer.get_text().size());
+        cursor_line = buffer.find_line_for_position(offset);
+        cursor_col = static_cast<int>(offset - buffer.calculate_absolute_position(cursor_line, 0));
+        clamp_column_position(buffer);
     }
 
     //fix
@@ -66,10 +161,10 @@ namespace Var {
     //     getch();
     // }
     
-    void Cursor::clamp(const Buffer& buffer, int& viewport_y) {
+    void Cursor::clamp(const Buffer& buffer, const RowIndex& row_index, int& viewport_y, int text_rows) {
         clamp_line_position(buffer);
         clamp_column_position(buffer);
-        adjust_viewport(buffer, viewport_y);
+        adjust_viewport(buffer, row_index, viewport_y, text_rows);
     }
     
     std::pair<int, int> Cursor::position() const {
@@ -115,4 +210,15 @@ namespace Var {
         cursor_col = std::min(cursor_col, get_current_line_length(buffer));
     }
 
+    int Cursor::visual_row(const Buffer& buffer, const RowIndex& row_index) const {
+        if (!row_index.active()) {
+            return cursor_line;
+        }
+
+        const int length = get_current_line_length(buffer);
+        const int last_segment = length > 0 ? (length - 1) / row_index.width() : 0;
+        const int segment = std::min(cursor_col / row_index.width(), last_segment);
+        return row_index.row_of_line(cursor_line) + segment;
+    }
+
 }
\ No newline at end of file
@@ -0,0 +1,298 @@
+#include <algorithm>
+#include <numeric>
+#include <functional>
+
+#include "disk_diff.hpp"
+
+namespace Var {
+
+    /**
+     * Reads the file at path and hashes its lines, for finish()
+     *
+     * Runs on a worker thread, so the lines are hashed in one go rather
+     * than spread over the pool. Throws std::runtime_error if the file
+     * cannot be read.
+     */
+    std::vector<uint64_t> DiskDiff::load(const std::string& path) {
+        Buffer disk;
+        std::string disk_name;
+        disk.load_file(path, disk_name);
+
+        std::vector<uint64_t> hashes(disk.line_count());
+        hash_range(disk, 0, hashes.size(), hashes);
+        return hashes;
+    }
+
+    /**
+     * Marks a load() as running; returns the request finish() has to
+     * check with pending()
+     */
+    uint64_t DiskDiff::start() {
+        disable();
+        load_pending = true;
+        return load_request;
+    }
+
+    bool DiskDiff::pending(uint64_t request) const {
+        return load_pending && request == load_request;
+    }
+
+    /**
+     * Diffs the buffer against the disk hashes of a finished load()
+     */
+    void DiskDiff::finish(const Buffer& buffer, std::vector<uint64_t>&& disk, WorkerPool& workers) {
+        load_pending = false;
+        disk_hashes = std::move(disk);
+        buffer_hashes = hash_lines(buffer, workers);
+
+        const int lines = static_cast<int>(buffer_hashes.size());
+        disk_line_of.assign(lines, -1);
+        marks.assign(lines, LineMark::None);
+        enabled = true;
+
+        diff_region(0, lines, 0, static_cast<int>(disk_hashes.size()));
+        update_marks(0, lines);
+    }
+
+    void DiskDiff::disable() {
+        enabled = false;
+        load_pending = false;
+        ++load_request;
+        disk_hashes = {};
+        buffer_hashes = {};
+        disk_line_of = {};
+        marks = {};
+    }
+
+    bool DiskDiff::active() const {
+        return enabled;
+    }
+
+    bool DiskDiff::loading() const {
+        return load_pending;
+    }
+
+    /**
+     * The buffer was just written to disk, so both sides are equal
+     */
+    void DiskDiff::saved() {
+        if (!enabled) return;
+
+        disk_hashes = buffer_hashes;
+        std::iota(disk_line_of.begin(), disk_line_of.end(), 0);
+        std::fill(marks.begin(), marks.end(), LineMark::None);
+    }
+
+    /**
+     * Reports an edit that replaced old_count lines with new_count
+     *
+     * Rehashes the new lines, then rediffs only between the closest
+     * lines on either side that still match the disk file. A region
+     * with more than MAX_EDIT_REGION lines left after trimming its
+     * common ends is not rediffed: its lines stay unmatched, so each
+     * keystroke in a big changed block costs one pass over it rather
+     * than a Myers run.
+     */
+    void DiskDiff::lines_changed(const Buffer& buffer, int first_line, int old_count, int new_count) {
+        if (!enabled) return;
+
+        // Overwrite what both ranges share, then shift only for the difference
+        const int lines = static_cast<int>(buffer_hashes.size());
+        old_count = std::min(old_count, lines - first_line);
+        const int shared = std::min(old_count, new_count);
+        if (old_count > new_count) {
+            const int erase_begin = first_line + shared;
+            const int erase_end = first_line + old_count;
+            buffer_hashes.erase(buffer_hashes.begin() + erase_begin, buffer_hashes.begin() + erase_end);
+            disk_line_of.erase(disk_line_of.begin() + erase_begin, disk_line_of.begin() + erase_end);
+            marks.erase(marks.begin() + erase_begin, marks.begin() + erase_end);
+        } else if (new_count > old_count) {
+            const int insert_at = first_line + shared;
+            const int inserted = new_count - old_count;
+            buffer_hashes.insert(buffer_hashes.begin() + insert_at, inserted, 0);
+            disk_line_of.insert(disk_line_of.begin() + insert_at, inserted, -1);
+            marks.insert(marks.begin() + insert_at, inserted, LineMark::None);
+        }
+
+        for (int line = first_line; line < first_line + new_count; ++line) {
+            buffer_hashes[line] = hash_line(buffer.get_line(line));
+            disk_line_of[line] = -1;
+        }
+
+        const int total = static_cast<int>(buffer_hashes.size());
+        int before = first_line - 1;
+        while (before >= 0 && disk_line_of[before] < 0) --before;
+        int after = first_line + new_count;
+        while (after < total && disk_line_of[after] < 0) ++after;
+
+        const int disk_begin = before >= 0 ? disk_line_of[before] + 1 : 0;
+        const int disk_end = after < total ? disk_line_of[after] : static_cast<int>(disk_hashes.size());
+        diff_region(before + 1, after, disk_begin, disk_end, MAX_EDIT_REGION);
+        update_marks(before + 1, after);
+    }
+
+    LineMark DiskDiff::mark(int line) const {
+        if (!enabled || line < 0 || static_cast<size_t>(line) >= marks.size()) {
+            return LineMark::None;
+        }
+        return marks[line];
+    }
+
+    std::vector<uint64_t> DiskDiff::hash_lines(const Buffer& buffer, WorkerPool& workers) {
+        std::vector<uint64_t> hashes(buffer.line_count());
+        workers.parallel_for(hashes.size(), HASH_GRAIN, [&](size_t begin, size_t end) {
+            hash_range(buffer, begin, end, hashes);
+        });
+        return hashes;
+    }
+
+    /**
+     * Hashes lines [begin, end) into hashes, walking the text from the
+     * first one on with a single index lookup
+     */
+    void DiskDiff::hash_range(const Buffer& buffer, size_t begin, size_t end, std::vector<uint64_t>& hashes) {
+        const std::string& text = buffer.get_text();
+        size_t start = buffer.line_offset(static_cast<int>(begin));
+        for (size_t line = begin; line < end; ++line) {
+            const size_t newline = std::min(text.find('\n', start), text.size());
+            hashes[line] = hash_line(std::string_view(text).substr(start, newline - start));
+            start = newline + 1;
+        }
+    }
+
+    uint64_t DiskDiff::hash_line(std::string_view line) {
+        return std::hash<std::string_view>{}(line);
+    }
+
+    /**
+     * Matches buffer lines [buffer_begin, buffer_end) against disk lines
+     * [disk_begin, disk_end)
+     *
+     * Common leading and trailing lines are matched directly; Myers' diff
+     * handles what remains in between, unless that is more than
+     * max_region lines on both sides together.
+     */
+    void DiskDiff::diff_region(int buffer_begin, int buffer_end, int disk_begin, int disk_end, int max_region) {
+        std::fill(disk_line_of.begin() + buffer_begin, disk_line_of.begin() + buffer_end, -1);
+
+        while (buffer_begin < buffer_end && disk_begin < disk_end &&
+               buffer_hashes[buffer_begin] == disk_hashes[disk_begin]) {
+            disk_line_of[buffer_begin++] = disk_begin++;
+        }
+        while (buffer_begin < buffer_end && disk_begin < disk_end &&
+               buffer_hashes[buffer_end - 1] == disk_hashes[disk_end - 1]) {
+            disk_line_of[--buffer_end] = --disk_end;
+        }
+        if (buffer_begin == buffer_end || disk_begin == disk_end) return;
+        if ((buffer_end - buffer_begin) + (disk_end - disk_begin) > max_region) return;
+
+        const auto matches = myers(buffer_hashes.data() + buffer_begin, buffer_end - buffer_begin,
+                                   disk_hashes.data() + disk_begin, disk_end - disk_begin);
+        for (const auto& [buffer_line, disk_line] : matches) {
+            disk_line_of[buffer_begin + buffer_line] = disk_begin + disk_line;
+        }
+    }
+
+    /**
+     * Myers' O(ND) diff, returning the matched (a, b) index pairs
+     *
+     * Only the diagonals reachable at each step are stored, so memory
+     * is O(D^2). Gives up (no matches) beyond MAX_EDIT_DISTANCE.
+     */
+    std::vector<std::pair<int, int>> DiskDiff::myers(const uint64_t* a, int n, const uint64_t* b, int m) {
+        std::vector<std::vector<int>> trace; // trace[d][k + d] = furthest x on diagonal k
+        const int max_d = std::min(n + m, MAX_EDIT_DISTANCE);
+        int found = -1;
+
+        for (int d = 0; d <= max_d && found < 0; ++d) {
+            std::vector<int> v(2 * d + 1);
+            for (int k = -d; k <= d; k += 2) {
+                int x;
+                if (d == 0) {
+                    x = 0;
+                } else {
+                    const std::vector<int>& previous = trace[d - 1];
+                    const bool down = k == -d || (k != d && previous[k - 1 + d - 1] < previous[k + 1 + d - 1]);
+                    x = down ? previous[k + 1 + d - 1] : previous[k - 1 + d - 1] + 1;
+                }
+
+                int y = x - k;
+                while (x < n && y < m && a[x] == b[y]) {
+                    ++x;
+                    ++y;
+                }
+                v[k + d] = x;
+
+                if (x >= n && y >= m) {
+                    found = d;
+                    break;
+                }
+            }
+            trace.push_back(std::move(v));
+        }
+
+        std::vector<std::pair<int, int>> matches;
+        if (found < 0) return matches;
+
+        int x = n;
+        int y = m;
+        for (int d = found; d > 0; --d) {
+            const std::vector<int>& previous = trace[d - 1];
+            const int k = x - y;
+            const bool down = k == -d || (k != d && previous[k - 1 + d - 1] < previous[k + 1 + d - 1]);
+            const int previous_k = down ? k + 1 : k - 1;
+            const int previous_x = previous[previous_k + d - 1];
+            const int previous_y = previous_x - previous_k;
+
+            while (x > previous_x && y > previous_y) {
+                matches.emplace_back(--x, --y);
+            }
+            x = previous_x;
+            y = previous_y;
+        }
+        while (x > 0 && y > 0) {
+            matches.emplace_back(--x, --y);
+        }
+
+        std::reverse(matches.begin(), matches.end());
+        return matches;
+    }
+
+    /**
+     * Recomputes gutter marks for lines [first_line, last_line]
+     *
+     * Works gap by gap between matched lines: unmatched buffer lines
+     * pair up with unmatched disk lines as changes, any surplus is an
+     * addition, and surplus disk lines are shown as a removal marker on
+     * the next matched line.
+     */
+    void DiskDiff::update_marks(int first_line, int last_line) {
+        const int lines = static_cast<int>(buffer_hashes.size());
+        const int disk_lines = static_cast<int>(disk_hashes.size());
+
+        int previous = first_line - 1;
+        while (previous >= 0 && disk_line_of[previous] < 0) --previous;
+        int previous_disk = previous >= 0 ? disk_line_of[previous] : -1;
+
+        for (int line = previous + 1; line <= lines; ++line) {
+            if (line < lines && disk_line_of[line] < 0) continue;
+
+            const int next_disk = line < lines ? disk_line_of[line] : disk_lines;
+            const int added = line - previous - 1;
+            const int removed = next_disk - previous_disk - 1;
+            for (int i = 0; i < added; ++i) {
+                marks[previous + 1 + i] = i < removed ? LineMark::Changed : LineMark::Added;
+            }
+
+            if (line < lines) {
+                marks[line] = removed > added ? LineMark::RemovedAbove : LineMark::None;
+            } else if (removed > added && added == 0 && lines > 0) {
+                marks[lines - 1] = LineMark::RemovedBelow;
+            }
+
+            previous = line;
+            previous_disk = next_disk;
+            if (line >= last_line) break;
+        }
+    }
+}
@@ -1,4 +1,11 @@
 #include <ncurses.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <fcntl.h>
+#include <cerrno>
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <sstream>
@@ -7,6 +14,7 @@
 #include <algorithm>
 
 #include "editor.hpp"
+#include "fold_regions.hpp"
 
 namespace Var {
     
@@ -16,12 +24,59 @@ namespace Var {
     }
     
     void Editor::load_file(const std::string& file_path) {
-        buffer.load_file(file_path, filename);
-        cursor.set_position(0, 0);
-        viewport.set_y(0);
+        // Binary files open in the hex view, straight from a mapping
+        if (HexView::is_binary(file_path)) {
+            hex.open(file_path);
+            filename = file_path;
+            return;
+        }
+
+        // A valid cache entry skips indexing and restores the last position
+        CachedView view;
+        const bool cached = index_cache.load(file_path, view, loaded_identity);
+
+        buffer.load_file(file_path, filename, std::move(view.line_offsets));
+        cursor().set_position(0, 0);
+        viewport().set_y(0);
         modified = false;
+
+        if (cached) {
+            cursor().set_position(view.cursor_line, view.cursor_col);
+            cursor().clamp_line_position(buffer);
+            cursor().clamp_column_position(buffer);
+            viewport().set_y(std::clamp(view.top_line, 0, buffer.line_count() - 1));
+        }
     }
     
+    /**
+     * Takes the buffer contents from stdin ("-" operand)
+     * 
+     * The pipe is moved to another descriptor and read in chunks by the
+     * event loop once run() starts, so output of long-running commands
+     * shows up as it arrives. The terminal is reopened as stdin for
+     * ncurses keyboard input.
+     */
+    void Editor::open_stdin() {
+        stream_fd = dup(STDIN_FILENO);
+        if (stream_fd < 0) {
+            throw std::runtime_error(std::string("Unable to read stdin: ") + strerror(errno));
+        }
+        fcntl(stream_fd, F_SETFL, fcntl(stream_fd, F_GETFL) | O_NONBLOCK);
+
+        const int tty = open("/dev/tty", O_RDWR);
+        if (tty < 0 || dup2(tty, STDIN_FILENO) < 0) {
+            throw std::runtime_error("Unable to open the terminal for keyboard input");
+        }
+        close(tty);
+
+        buffer.replace_text("");
+        filename.clear();
+        stream_name = "[stdin]";
+        cursor().set_position(0, 0);
+        viewport().set_y(0);
+        modified = false;
+    }
+
     void Editor::run() {
         initscr();
         raw();
@@ -38,83 +93,1097 @@ namespace Var {
         attron(COLOR_PAIR(2)); 
         bkgd(COLOR_PAIR(1));
 
-        viewport.init_buffers();
+        ctrl_home_key = bind_extended_key("kHOM5", "\033[1;5H", KEY_MAX + 1);
+        ctrl_end_key = bind_extended_key("kEND5", "\033[1;5F", KEY_MAX + 2);
 
-        int rows, cols;
-        getmaxyx(stdscr, rows, cols);
-        viewport.update_size(cols, rows);
+        arrange_windows();
+        viewport().init_buffers();
+        viewport().set_diff(&diff);
+        viewport().set_brackets(&brackets);
+        if (!hex.active()) {
+            index_brackets();
+            index_words();
+        }
+
+        // Tables open as such when the name says so
+        const std::string extension = filename.size() >= 4 ? filename.substr(filename.size() - 4) : "";
+        if (!hex.active() && (extension == ".csv" || extension == ".tsv")) {
+            viewport().toggle_csv(buffer);
+        }
+
+        // A followed file opens with its last screenful in view (wrap starts off)
+        if (follower.active()) {
+            viewport().set_y(std::max(buffer.line_count() - viewport().page_rows(), 0));
+        }
+
+        loop.watch(STDIN_FILENO, [this] { read_input(); });
+        loop.on_resize([this] { resize(); });
+        if (stream_fd >= 0) {
+            loop.watch(stream_fd, [this] { read_stream(); });
+        }
     
         while (running) {
-            viewport.draw(buffer, cursor, modified, filename);
-            int ch = getch();
-            handle_input(ch);
-            
-            if (ch == KEY_RESIZE) {
-                getmaxyx(stdscr, rows, cols);
-                viewport.update_size(cols, rows);
+            if (dirty) {
+                render();
+                dirty = false;
             }
+            loop.run_once();
+        }
+
+        loop.unwatch(STDIN_FILENO);
+        if (indexing_stop) {
+            *indexing_stop = true; // don't wait for a count nobody needs
         }
-    
         endwin();
+        remember_view();
+    }
+
+    Viewport& Editor::viewport() {
+        return windows[active].viewport;
+    }
+
+    Cursor& Editor::cursor() {
+        return windows[active].cursor;
+    }
+
+    /**
+     * Composes all windows into one frame and flushes it to the terminal
+     * 
+     * Every viewport only copies its rows into stdscr, so the terminal
+     * sees a single update per frame however many windows there are.
+     * The active window draws last so it places the hardware cursor.
+     */
+    void Editor::render() {
+        const std::string& name = filename.empty() ? stream_name : filename;
+        if (hex.active()) {
+            hex.draw(name);
+            if (prompt_done) draw_prompt();
+            refresh();
+            return;
+        }
+
+        for (size_t i = 0; i < windows.size(); ++i) {
+            if (i == active) continue;
+            windows[i].viewport.draw(buffer, windows[i].cursor, modified, name, false);
+        }
+        for (const WindowRect& separator : separators) {
+            mvvline(separator.top, separator.left, ACS_VLINE, separator.height);
+        }
+        windows[active].viewport.draw(buffer, windows[active].cursor, modified, name, true);
+        if (prompt_done) draw_prompt();
+        refresh();
+    }
+
+    /**
+     * Places every window in its part of the screen
+     */
+    void Editor::arrange_windows() {
+        int rows, cols;
+        getmaxyx(stdscr, rows, cols);
+
+        std::vector<WindowRect> areas(windows.size());
+        layout.arrange(cols, rows, areas, separators);
+        for (size_t i = 0; i < windows.size(); ++i) {
+            const WindowRect& area = areas[i];
+            windows[i].viewport.place(area.top, area.left, area.width, area.height);
+        }
+        erase();
+        dirty = true;
+    }
+
+    /**
+     * Stores the line index and position for the next open of this file
+     * 
+     * Skipped with unsaved changes: the in-memory index then no longer
+     * describes the file on disk. Also skipped for files big enough to
+     * have a compact index, whose full index would blow the memory
+     * budget just to be written out.
+     */
+    void Editor::remember_view() {
+        // A followed file keeps changing under the buffer
+        if (filename.empty() || modified || buffer.compact_index() || hex.active() || follower.active()) return;
+
+        const auto [cursor_line, cursor_col] = cursor().position();
+        CachedView view;
+        view.line_offsets = buffer.get_line_offsets();
+        view.cursor_line = cursor_line;
+        view.cursor_col = cursor_col;
+        view.top_line = viewport().rows().locate(viewport().get_y()).first;
+        index_cache.store(filename, view, loaded_identity);
+    }
+
+    /**
+     * Runs work on a worker thread, then done on the UI thread
+     * 
+     * done is delivered through the event loop's completion queue and
+     * triggers a repaint, so it may freely touch editor state.
+     */
+    void Editor::run_in_background(std::function<void()> work, EventLoop::Callback done) {
+        workers.submit([this, work = std::move(work), done = std::move(done)] {
+            work();
+            loop.post([this, done] {
+                done();
+                dirty = true;
+            });
+        });
+    }
+
+    /**
+     * Shows a status bar message for a few seconds
+     */
+    void Editor::show_message(const std::string& message) {
+        viewport().set_message(message);
+        hex.set_message(message);
+        loop.cancel_timer(message_timer);
+        message_timer = loop.add_timer(3000, [this] {
+            for (Window& window : windows) {
+                window.viewport.set_message("");
+            }
+            hex.set_message("");
+            dirty = true;
+        });
+        dirty = true;
+    }
+
+    /**
+     * Handles every key already queued on stdin
+     * 
+     * Everything pending (e.g. auto-repeated arrows) is processed
+     * before the next repaint, so a held key costs one redraw per batch.
+     * Nothing in handle_input() waits for more keys: an open prompt
+     * only collects them, so the loop is never held up.
+     */
+    void Editor::read_input() {
+        nodelay(stdscr, TRUE);
+        int ch;
+        while (running && (ch = getch()) != ERR) {
+            handle_input(ch);
+        }
+        nodelay(stdscr, FALSE);
+        dirty = true;
+    }
+
+    /**
+     * Appends one chunk of piped input
+     * 
+     * At most STREAM_CHUNK bytes per wakeup, so a fast producer cannot
+     * starve the keyboard and each repaint shows a bit more text.
+     */
+    void Editor::read_stream() {
+        static constexpr size_t STREAM_CHUNK = 64 * 1024;
+        char chunk[STREAM_CHUNK];
+
+        const ssize_t count = read(stream_fd, chunk, sizeof(chunk));
+        if (count > 0) {
+            append_input({chunk, static_cast<size_t>(count)}, false);
+            return;
+        }
+        if (count < 0 && (errno == EAGAIN || errno == EINTR)) return;
+
+        loop.unwatch(stream_fd);
+        close(stream_fd);
+        stream_fd = -1;
+        show_message(count < 0 ? std::string("Error reading stdin: ") + strerror(errno) : "End of input");
+    }
+
+    /**
+     * Adds text at the end of the buffer
+     * 
+     * Only the last line and the new ones are re-measured. Doesn't
+     * count as a modification: the text still matches its source.
+     * With keep_at_end, a cursor on the last line moves along to the
+     * new last line and the view scrolls with it.
+     */
+    void Editor::append_input(std::string_view chunk, bool keep_at_end) {
+        const int last_line = buffer.line_count() - 1;
+        const bool at_end = keep_at_end && cursor().position().first == last_line;
+
+        const size_t old_size = buffer.get_text().size();
+        words.before_edit(buffer.get_text(), old_size, old_size);
+        buffer.append(chunk);
+        words.after_edit(buffer.get_text(), old_size, buffer.get_text().size());
+        lines_changed(last_line, 1, buffer.line_count() - last_line, old_size);
+        if (at_end) {
+            cursor().go_to_line(buffer, buffer.line_count() - 1);
+            scroll_to_cursor();
+        }
+        dirty = true;
+    }
+
+    /**
+     * Keeps following the loaded file as other programs append to it
+     * 
+     * Starts at the end of the file, like tail -f. Throws
+     * std::runtime_error if the file cannot be watched.
+     */
+    void Editor::follow() {
+        if (filename.empty()) {
+            throw std::runtime_error("No file to follow");
+        }
+        if (hex.active()) {
+            throw std::runtime_error("Cannot follow a binary file");
+        }
+
+        follower.start(filename, static_cast<off_t>(buffer.get_text().size()));
+        loop.watch(follower.descriptor(), [this] {
+            follower.drain_notifications();
+            schedule_follow(FOLLOW_DELAY_MS);
+        });
+        follow_poll_timer = loop.add_timer(FOLLOW_POLL_MS, [this] { schedule_follow(0); }, true);
+
+        cursor().go_to_line(buffer, buffer.line_count() - 1);
+        scroll_to_cursor();
+    }
+
+    void Editor::schedule_follow(int delay_ms) {
+        if (follow_timer != 0) return;
+
+        follow_timer = loop.add_timer(delay_ms, [this] {
+            follow_timer = 0;
+            read_follow();
+        });
+    }
+
+    /**
+     * Takes in whatever happened to the followed file
+     * 
+     * Appends extend the buffer; a truncated or rotated file replaces
+     * it, unless that would throw away unsaved edits, in which case
+     * following stops. A large backlog is read in several steps with
+     * input handled in between.
+     */
+    void Editor::read_follow() {
+        std::string text;
+        FileFollower::Change change;
+        try {
+            change = follower.read_changes(text);
+        } catch (const std::runtime_error& e) {
+            show_message(std::string("Error: ") + e.what());
+            return;
+        }
+
+        if (change == FileFollower::Change::Appended) {
+            append_input(text, true);
+        } else if (change == FileFollower::Change::Replaced && modified) {
+            stop_following();
+            show_message("File replaced, kept your edits; stopped following");
+            return;
+        } else if (change == FileFollower::Change::Replaced) {
+            const int old_lines = buffer.line_count();
+            buffer.replace_text(std::move(text));
+            lines_changed(0, old_lines, buffer.line_count());
+            index_words();
+            cursor().go_to_line(buffer, buffer.line_count() - 1);
+            scroll_to_cursor();
+            modified = false;
+            invalidate_windows();
+            show_message("File truncated or replaced, reloaded");
+        }
+
+        if (follower.has_more()) {
+            schedule_follow(0);
+        }
+    }
+
+    void Editor::stop_following() {
+        loop.unwatch(follower.descriptor());
+        loop.cancel_timer(follow_poll_timer);
+        loop.cancel_timer(follow_timer);
+        follow_poll_timer = 0;
+        follow_timer = 0;
+        follower.stop();
+    }
+
+    /**
+     * Scrolls the viewport so the cursor is visible
+     */
+    void Editor::scroll_to_cursor() {
+        int viewport_y = viewport().get_y();
+        cursor().clamp(buffer, viewport().rows(), viewport_y, viewport().page_rows());
+        viewport().set_y(viewport_y);
+    }
+
+    /**
+     * Scrolls every window so its cursor is visible after the window
+     * changed size
+     */
+    void Editor::scroll_windows_to_cursor() {
+        for (Window& window : windows) {
+            int viewport_y = window.viewport.get_y();
+            window.cursor.clamp(buffer, window.viewport.rows(), viewport_y, window.viewport.page_rows());
+            window.viewport.set_y(viewport_y);
+        }
+    }
+
+    /**
+     * Applies a terminal resize reported through the signalfd
+     * 
+     * SIGWINCH is blocked, so ncurses does not notice the new size
+     * by itself and has to be told explicitly.
+     */
+    void Editor::resize() {
+        winsize size;
+        if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) == 0) {
+            resizeterm(size.ws_row, size.ws_col);
+        }
+
+        arrange_windows();
+        handle_input(KEY_RESIZE);
+        dirty = true;
     }
 
     void Editor::handle_input(int ch) {
-        auto [cursor_line, cursor_col] = cursor.position();
-        int viewport_y = viewport.get_y();
+        // An open prompt takes every key except a resize
+        if (prompt_done && ch != KEY_RESIZE) {
+            handle_prompt_key(ch);
+            return;
+        }
+
+        if (hex.active()) {
+            handle_hex_input(ch);
+            return;
+        }
+
+        auto [cursor_line, cursor_col] = cursor().position();
+        int viewport_y = viewport().get_y();
+
+        // The completion popup takes its own keys; any other closes it
+        // and is handled as usual
+        const bool completing = !completions.empty();
+        if (completing) {
+            if (handle_completion_key(ch)) return;
+            close_completions();
+        }
+
+        // A selection lasts until the next key that does not grow it
+        const auto [selection_begin, selection_end] = viewport().selection();
+        const bool selected = selection_begin != selection_end;
+        if (selected && ch != ('e' & 0x1f)) {
+            viewport().set_selection(0, 0);
+        }
+
+        if (ch == ctrl_home_key) {
+            ch = KEY_SHOME;
+        } else if (ch == ctrl_end_key) {
+            ch = KEY_SEND;
+        }
     
         switch (ch) {
             case KEY_UP:    
-                cursor.move_up(buffer); 
+                cursor().move_up(buffer, viewport().rows()); 
                 break;
             case KEY_DOWN:  
-                cursor.move_down(buffer); 
+                cursor().move_down(buffer, viewport().rows()); 
                 break;
             case KEY_LEFT:  
-                cursor.move_left(buffer); 
+                cursor().move_left(buffer); 
                 break;
             case KEY_RIGHT: 
-                cursor.move_right(buffer); 
+                cursor().move_right(buffer); 
+                break;
+            case KEY_PPAGE:
+                page(-1, viewport_y);
+                break;
+            case KEY_NPAGE:
+                page(1, viewport_y);
+                break;
+            case KEY_HOME:
+                cursor().move_to_line_start();
+                break;
+            case KEY_END:
+                cursor().move_to_line_end(buffer);
+                break;
+            case KEY_SHOME: // Ctrl+Home
+                cursor().move_to_buffer_start();
+                break;
+            case KEY_SEND: // Ctrl+End
+                cursor().move_to_buffer_end(buffer);
+                break;
+            case 'g' & 0x1f: // Ctrl+G
+                prompt("Go to line (or @byte offset): ", [this](const std::string& target) {
+                    go_to(target);
+                });
                 break;
-            // case '\t':
-            //     cursor.tab(buffer);
-            //     break;
             case KEY_BACKSPACE:
-            case 127:
+            case 127: {
+                if (selected) {
+                    delete_selection(selection_begin, selection_end);
+                    break;
+                }
+                const int lines_before = buffer.line_count();
+                const size_t at = buffer.calculate_absolute_position(cursor_line, cursor_col);
+                const size_t deleted = at > 0 ? at - 1 : 0;
+                words.before_edit(buffer.get_text(), deleted, at);
                 buffer.delete_char_before_cursor(cursor_line, cursor_col);
-                cursor.move_left(buffer);
+                words.after_edit(buffer.get_text(), deleted, deleted);
+                lines_changed(cursor_line, 1 + lines_before - buffer.line_count(), 1);
+                cursor().move_left(buffer);
                 modified = true;
                 break;
+            }
             case 's' & 0x1f: // Ctrl+S
                 try {
                     buffer.save_file(filename);
                     modified = false;
+                    // The file now holds exactly the buffer
+                    if (!index_cache.identify(filename, loaded_identity)) {
+                        loaded_identity = LineIndexCache::FileIdentity{};
+                    }
+                    // A load still running may have read the file before the save
+                    if (diff.loading()) {
+                        load_diff();
+                    } else {
+                        diff.saved();
+                    }
+                    follower.saved(static_cast<off_t>(buffer.get_text().size()));
+                    invalidate_windows();
                 } catch (const std::runtime_error& e) {
-                    attron(COLOR_PAIR(2));
-                    mvprintw(0, 0, "Error: %s", e.what());
-                    attroff(COLOR_PAIR(2));
-                    refresh();
-                    getch();
+                    show_message(std::string("Error: ") + e.what());
                 }
                 break;
             case 'l' & 0x1f: // Ctrl+L
-                viewport.toggle_line_numbers();
+                viewport().toggle_line_numbers();
+                break;
+            case 'd' & 0x1f: // Ctrl+D
+                toggle_diff();
                 break;
+            case 'f' & 0x1f: // Ctrl+F
+                toggle_fold();
+                viewport_y = viewport().get_y();
+                break;
+            case 'w' & 0x1f: // Ctrl+W
+                viewport().toggle_soft_wrap(buffer);
+                viewport_y = viewport().get_y();
+                break;
+            case 'b' & 0x1f: // Ctrl+B
+                jump_to_match();
+                break;
+            case 'p' & 0x1f: // Ctrl+P
+                jump_to_parent();
+                break;
+            case 'e' & 0x1f: // Ctrl+E
+                select_enclosing_block();
+                break;
+            case 'n' & 0x1f: // Ctrl+N
+                complete_word(true);
+                break;
+            case 'r' & 0x1f: // Ctrl+R
+                if (!viewport().toggle_csv(buffer)) {
+                    show_message("No delimiter found");
+                }
+                viewport_y = viewport().get_y();
+                break;
+            case '\t':
+                move_to_field(1);
+                break;
+            case KEY_BTAB: // Shift+Tab
+                move_to_field(-1);
+                break;
+            case 't' & 0x1f: // Ctrl+T
+                split_window(false);
+                return;
+            case 'v' & 0x1f: // Ctrl+V
+                split_window(true);
+                return;
+            case 'o' & 0x1f: // Ctrl+O
+                other_window();
+                return;
+            case 'q' & 0x1f: // Ctrl+Q
+                close_window();
+                return;
             case 'x' & 0x1f: // Ctrl+X
                 running = false;
                 break;
             default:
                 if (isprint(ch) || ch == '\n') {
+                    const int lines_before = buffer.line_count();
+                    const size_t at = buffer.calculate_absolute_position(cursor_line, cursor_col);
+                    words.before_edit(buffer.get_text(), at, at);
                     buffer.insert_char(cursor_line, cursor_col, (char)ch);
+                    words.after_edit(buffer.get_text(), at, at + 1);
+                    lines_changed(cursor_line, 1, 1 + buffer.line_count() - lines_before);
                     if (ch == '\n') {
-                        cursor.set_position(cursor_line + 1, 0);
+                        cursor().set_position(cursor_line + 1, 0);
                     } else {
-                        cursor.move_right(buffer);
+                        cursor().move_right(buffer);
                     }
                     modified = true;
                 }
                 break;
         }
-        cursor.clamp(buffer, viewport_y);
-        viewport.set_y(viewport_y);
+        // Moves that land inside a fold (left/right, go to line) open it
+        viewport().set_y(viewport_y);
+        viewport().reveal(cursor().position().first);
+        viewport_y = viewport().get_y();
+        cursor().clamp(buffer, viewport().rows(), viewport_y, viewport().page_rows());
+        viewport().set_y(viewport_y);
+
+        // Typing on in the word keeps the popup open with fresh matches
+        const bool word_key = ch < 0x80 && WordIndex::is_word_char(static_cast<char>(ch));
+        if (completing && (word_key || ch == KEY_BACKSPACE || ch == 127)) {
+            complete_word(false);
+        }
+    }
+
+    /**
+     * Key handling while a binary file is shown in the hex view
+     * 
+     * Hex digits (or characters, in the ASCII column) overwrite the
+     * byte at the cursor; Tab switches columns.
+     */
+    void Editor::handle_hex_input(int ch) {
+        if (ch == ctrl_home_key) {
+            ch = KEY_SHOME;
+        } else if (ch == ctrl_end_key) {
+            ch = KEY_SEND;
+        }
+
+        switch (ch) {
+            case KEY_UP:
+                hex.move_by(-HexView::BYTES_PER_ROW);
+                break;
+            case KEY_DOWN:
+                hex.move_by(HexView::BYTES_PER_ROW);
+                break;
+            case KEY_LEFT:
+                hex.move_by(-1);
+                break;
+            case KEY_RIGHT:
+                hex.move_by(1);
+                break;
+            case KEY_PPAGE:
+                hex.page(-1);
+                break;
+            case KEY_NPAGE:
+                hex.page(1);
+                break;
+            case KEY_HOME:
+                hex.move_to_row_start();
+                break;
+            case KEY_END:
+                hex.move_to_row_end();
+                break;
+            case KEY_SHOME: // Ctrl+Home
+                hex.move_to(0);
+                break;
+            case KEY_SEND: // Ctrl+End
+                hex.move_to(SIZE_MAX);
+                break;
+            case '\t':
+                hex.toggle_side();
+                break;
+            case 'g' & 0x1f: // Ctrl+G
+                prompt("Go to offset: ", [this](const std::string& target) {
+                    try {
+                        if (!target.empty()) {
+                            hex.move_to(parse_offset(target[0] == '@' ? target.substr(1) : target));
+                        }
+                    } catch (const std::logic_error&) {
+                        // Not a number, leave the cursor where it is
+                    }
+                });
+                break;
+            case 's' & 0x1f: // Ctrl+S
+                try {
+                    hex.save();
+                } catch (const std::runtime_error& e) {
+                    show_message(std::string("Error: ") + e.what());
+                }
+                break;
+            case 'x' & 0x1f: // Ctrl+X
+                running = false;
+                break;
+            default:
+                hex.overwrite(ch);
+                break;
+        }
+    }
+
+    /**
+     * Tells every view of the buffer that old_count lines starting at
+     * first_line were replaced by new_count lines; changed_from is the
+     * first changed byte when known (appends)
+     */
+    void Editor::lines_changed(int first_line, int old_count, int new_count, size_t changed_from) {
+        brackets.lines_changed(buffer, first_line, old_count, new_count, changed_from);
+        for (size_t i = 0; i < windows.size(); ++i) {
+            windows[i].viewport.lines_changed(buffer, first_line, old_count, new_count);
+            if (i == active) continue;
+
+            // Other cursors stay on their text: lines below the edit
+            // shift, lines that were removed collapse onto its end
+            auto [line, col] = windows[i].cursor.position();
+            if (line >= first_line + old_count) {
+                line += new_count - old_count;
+            } else if (line >= first_line + new_count) {
+                line = first_line + new_count - 1;
+            }
+            windows[i].cursor.set_position(std::max(line, 0), col);
+            windows[i].cursor.clamp_line_position(buffer);
+            windows[i].cursor.clamp_column_position(buffer);
+        }
+        diff.lines_changed(buffer, first_line, old_count, new_count);
+    }
+
+    /**
+     * Repaints every window for the next frame
+     */
+    void Editor::invalidate_windows() {
+        for (Window& window : windows) {
+            window.viewport.invalidate();
+        }
+    }
+
+    /**
+     * Shows or hides added/changed/removed markers against the saved file
+     */
+    void Editor::toggle_diff() {
+        if (diff.active() || diff.loading()) {
+            diff.disable();
+        } else if (filename.empty()) {
+            show_message("No file to compare with");
+        } else {
+            load_diff();
+        }
+        invalidate_windows();
+    }
+
+    /**
+     * Reads the file on disk in the background, then diffs the buffer
+     * against it as it is by then
+     */
+    void Editor::load_diff() {
+        const uint64_t request = diff.start();
+        auto disk = std::make_shared<std::vector<uint64_t>>();
+        auto error = std::make_shared<std::string>();
+        run_in_background([path = filename, disk, error] {
+            try {
+                *disk = DiskDiff::load(path);
+            } catch (const std::runtime_error& e) {
+                *error = e.what();
+            }
+        }, [this, request, disk, error] {
+            if (!diff.pending(request)) return;
+
+            if (!error->empty()) {
+                diff.disable();
+                show_message("Error: " + *error);
+                return;
+            }
+            diff.finish(buffer, std::move(*disk), workers);
+            invalidate_windows();
+        });
+    }
+
+    /**
+     * Folds the region at the cursor, or opens the fold it heads
+     * 
+     * The region is the one headed by the cursor line (bracket or
+     * indentation) or else the indentation block around it; the cursor
+     * moves to the header.
+     */
+    void Editor::toggle_fold() {
+        const int line = cursor().position().first;
+        if (viewport().rows().fold_end(line) >= 0) {
+            viewport().unfold(line);
+            return;
+        }
+
+        const auto [header, last_line] = FoldRegions::enclosing(buffer, brackets, line);
+        if (header < 0) {
+            show_message("Nothing to fold here");
+            return;
+        }
+        viewport().fold(buffer, header, last_line);
+        cursor().set_position(header, 0);
+    }
+
+    /**
+     * Moves the cursor to the bracket matching the one under it
+     */
+    void Editor::jump_to_match() {
+        const auto [line, col] = cursor().position();
+        const size_t match = brackets.match(buffer, buffer.calculate_absolute_position(line, col));
+        if (match == BracketIndex::NONE) {
+            show_message("No matching bracket");
+            return;
+        }
+        cursor().go_to_offset(buffer, match);
+    }
+
+    /**
+     * Moves the cursor to the opening bracket around it
+     */
+    void Editor::jump_to_parent() {
+        const auto [line, col] = cursor().position();
+        const size_t parent = brackets.parent(buffer, buffer.calculate_absolute_position(line, col));
+        if (parent == BracketIndex::NONE) {
+            show_message("Not inside brackets");
+            return;
+        }
+        cursor().go_to_offset(buffer, parent);
+    }
+
+    /**
+     * Selects the bracket pair around the cursor, brackets included
+     * 
+     * On a bracket its own pair is taken; repeating the key selects the
+     * next enclosing pair. The cursor moves to the opening bracket.
+     */
+    void Editor::select_enclosing_block() {
+        const auto [line, col] = cursor().position();
+        const size_t pos = buffer.calculate_absolute_position(line, col);
+        const auto [selection_begin, selection_end] = viewport().selection();
+
+        size_t opener;
+        if (selection_begin != selection_end) {
+            opener = brackets.parent(buffer, selection_begin);
+        } else if (const size_t match = brackets.match(buffer, pos); match != BracketIndex::NONE) {
+            opener = std::min(pos, match);
+        } else {
+            opener = brackets.parent(buffer, pos);
+        }
+
+        const size_t closer = opener == BracketIndex::NONE ? BracketIndex::NONE : brackets.match(buffer, opener);
+        if (closer == BracketIndex::NONE) {
+            show_message("Not inside brackets");
+            return;
+        }
+        viewport().set_selection(opener, closer + 1);
+        cursor().go_to_offset(buffer, opener);
+    }
+
+    /**
+     * Moves the cursor to the start of the next (or previous) field of
+     * a table line; does nothing outside the table view
+     */
+    void Editor::move_to_field(int direction) {
+        const CsvLayout* csv = viewport().csv_layout();
+        if (!csv) return;
+
+        const auto [line, col] = cursor().position();
+        const std::vector<CsvField> fields = CsvLayout::split(buffer.get_line(line), csv->get_delimiter());
+        const int target = CsvLayout::field_at(fields, col) + direction;
+        if (target < 0 || target >= static_cast<int>(fields.size())) return;
+        cursor().set_position(line, fields[target].text_begin);
+    }
+
+    /**
+     * Removes the selected text [begin, end)
+     */
+    void Editor::delete_selection(size_t begin, size_t end) {
+        const int first_line = buffer.find_line_for_position(begin);
+        const int last_line = buffer.find_line_for_position(end);
+        words.before_edit(buffer.get_text(), begin, end);
+        buffer.erase(begin, end);
+        words.after_edit(buffer.get_text(), begin, begin);
+        lines_changed(first_line, last_line - first_line + 1, 1);
+        cursor().go_to_offset(buffer, begin);
+        modified = true;
+    }
+
+    /**
+     * Builds the bracket index in the background, one slice after the
+     * other
+     * 
+     * Bracket matching finds nothing until it is ready; edits
+     * made meanwhile only send the build back to where they are.
+     */
+    void Editor::index_brackets() {
+        auto slice = std::make_shared<BracketIndex::Slice>();
+        if (!brackets.next_slice(buffer, *slice)) return;
+
+        run_in_background([slice] {
+            BracketIndex::scan_slice(*slice);
+        }, [this, slice] {
+            brackets.add_slice(std::move(*slice));
+            index_brackets();
+        });
+    }
+
+    /**
+     * Counts the words of the buffer in the background
+     * 
+     * Typing goes on while the count runs; edits made meanwhile are
+     * merged into its result. A count still running is abandoned.
+     */
+    void Editor::index_words() {
+        if (indexing_stop) {
+            *indexing_stop = true;
+        }
+        indexing_stop = std::make_shared<std::atomic<bool>>(false);
+
+        const uint64_t generation = words.reset();
+        count_next_slice(generation, std::make_shared<WordIndex::Tally>());
+    }
+
+    /**
+     * Hands the next slice of the text to the indexer, or sorts the
+     * tally once all of it was counted
+     * 
+     * Only one slice is copied at a time, on the UI thread, and the
+     * next one is taken when it is done; the buffer itself is never
+     * read by the indexer.
+     */
+    void Editor::count_next_slice(uint64_t generation, std::shared_ptr<WordIndex::Tally> tally) {
+        auto slice = std::make_shared<const std::string>(words.next_slice(buffer.get_text()));
+        indexer.submit([this, slice, tally, generation, stop = indexing_stop] {
+            // Idle priority: even on a single core, keys are handled first
+            sched_param priority{};
+            pthread_setschedparam(pthread_self(), SCHED_IDLE, &priority);
+            if (*stop) return;
+
+            if (!slice->empty()) {
+                WordIndex::count(*slice, *tally);
+                loop.post([this, tally, generation, stop] {
+                    if (!*stop) count_next_slice(generation, tally);
+                });
+                return;
+            }
+
+            auto counts = std::make_shared<WordIndex::Counts>(WordIndex::sort(std::move(*tally)));
+            if (*stop) return;
+            loop.post([this, counts, generation] {
+                words.merge(std::move(*counts), generation);
+            });
+        });
+    }
+
+    /**
+     * Offers the words that continue the one before the cursor
+     * 
+     * on_request is set for Ctrl+N, which explains in the status bar
+     * why nothing is offered; refreshing while typing stays quiet.
+     */
+    void Editor::complete_word(bool on_request) {
+        const auto [line, col] = cursor().position();
+        const std::string_view text = buffer.get_line(line);
+        const size_t end = std::min<size_t>(col, text.size());
+        size_t start = end;
+        while (start > 0 && WordIndex::is_word_char(text[start - 1])) --start;
+
+        if (start == end) {
+            if (on_request) show_message("No word to complete");
+            return;
+        }
+        if (!words.ready()) {
+            if (on_request) show_message("Still counting words, try again shortly");
+            return;
+        }
+
+        completions = words.complete(text.substr(start, end - start), MAX_COMPLETIONS);
+        if (completions.empty()) {
+            if (on_request) show_message("No completions");
+            return;
+        }
+        completion_choice = 0;
+        completion_prefix = end - start;
+        viewport().set_completions(completions, completion_choice, static_cast<int>(completion_prefix));
+    }
+
+    /**
+     * Keys of the open completion popup: Up/Down choose, Enter or Tab
+     * inserts the choice, Esc closes. Returns false for other keys.
+     */
+    bool Editor::handle_completion_key(int ch) {
+        const int count = static_cast<int>(completions.size());
+        switch (ch) {
+            case KEY_DOWN:
+            case KEY_UP:
+                completion_choice = (completion_choice + (ch == KEY_DOWN ? 1 : count - 1)) % count;
+                viewport().set_completions(completions, completion_choice, static_cast<int>(completion_prefix));
+                return true;
+            case '\n':
+            case '\t':
+                accept_completion();
+                close_completions();
+                scroll_to_cursor();
+                return true;
+            case 27: // Esc
+                close_completions();
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    /**
+     * Inserts the rest of the chosen word at the cursor
+     */
+    void Editor::accept_completion() {
+        const std::string rest = completions[completion_choice].substr(completion_prefix);
+        const auto [line, col] = cursor().position();
+        const size_t at = buffer.calculate_absolute_position(line, col);
+
+        words.before_edit(buffer.get_text(), at, at);
+        buffer.insert(at, rest);
+        words.after_edit(buffer.get_text(), at, at + rest.size());
+        lines_changed(line, 1, 1);
+        cursor().set_position(line, col + static_cast<int>(rest.size()));
+        modified = true;
+    }
+
+    void Editor::close_completions() {
+        completions.clear();
+        viewport().set_completions(completions, 0, 0);
+    }
+
+    /**
+     * Splits the active window in two, both showing the same place
+     * 
+     * The new window starts as a copy of the active one (scroll
+     * position, wrap, folds, cursor) and receives the input.
+     */
+    void Editor::split_window(bool side_by_side) {
+        const WindowRect area = viewport().area();
+        if (side_by_side ? (area.width - 1) / 2 < MIN_WINDOW_WIDTH : area.height / 2 < MIN_WINDOW_HEIGHT) {
+            show_message("Window too small to split");
+            return;
+        }
+
+        Window copy = windows[active];
+        windows.push_back(std::move(copy));
+        windows.back().viewport.init_buffers();
+        layout.split(static_cast<int>(active), side_by_side, static_cast<int>(windows.size() - 1));
+        active = windows.size() - 1;
+
+        arrange_windows();
+        scroll_windows_to_cursor();
+    }
+
+    /**
+     * Closes the active window; its area goes to the neighbouring one
+     */
+    void Editor::close_window() {
+        if (windows.size() == 1) {
+            show_message("Only one window");
+            return;
+        }
+
+        viewport().release_buffers();
+        windows.erase(windows.begin() + active);
+        layout.close(static_cast<int>(active));
+        active = std::min(active, windows.size() - 1);
+        arrange_windows();
+        scroll_windows_to_cursor();
+    }
+
+    void Editor::other_window() {
+        active = (active + 1) % windows.size();
+        dirty = true;
+    }
+
+    /**
+     * Resolves the key code ncurses reports for an extended terminfo key
+     * (e.g. kHOM5 = Ctrl+Home), binding the common xterm sequence to
+     * a private code when the terminal description lacks it.
+     */
+    int Editor::bind_extended_key(const char* capability, const char* fallback, int code) {
+        const char* sequence = tigetstr(capability);
+        if (sequence != nullptr && sequence != reinterpret_cast<char*>(-1)) {
+            const int bound = key_defined(sequence);
+            if (bound > 0) return bound;
+        }
+
+        define_key(fallback, code);
+        return code;
+    }
+
+    /**
+     * Scrolls by one screenful and moves the cursor by the same amount
+     * 
+     * Both are direct jumps through the row index rather than repeated
+     * single-line moves.
+     */
+    void Editor::page(int direction, int& viewport_y) {
+        const RowIndex& rows = viewport().rows();
+        const int page_rows = viewport().page_rows();
+        const int max_y = std::max(rows.total_rows() - page_rows, 0);
+
+        viewport_y = std::clamp(viewport_y + direction * page_rows, 0, max_y);
+        if (direction < 0) {
+            cursor().move_page_up(buffer, rows, page_rows);
+        } else {
+            cursor().move_page_down(buffer, rows, page_rows);
+        }
+    }
+
+    /**
+     * Opens a one-line prompt in the status bar
+     * 
+     * Keys go to the prompt until it is entered or cancelled, but the
+     * event loop keeps running meanwhile: streamed input, follow reads
+     * and resizes are still handled. done receives the entered text;
+     * it is not called when the prompt is cancelled with Esc or Ctrl+G.
+     */
+    void Editor::prompt(const std::string& label, std::function<void(const std::string&)> done) {
+        prompt_label = label;
+        prompt_input.clear();
+        prompt_done = std::move(done);
+        dirty = true;
+    }
+
+    /**
+     * Keys of the open prompt: Enter submits, Esc or Ctrl+G cancels
+     */
+    void Editor::handle_prompt_key(int ch) {
+        if (ch == '\n' || ch == KEY_ENTER) {
+            const auto done = std::move(prompt_done);
+            prompt_done = nullptr;
+            done(prompt_input);
+        } else if (ch == 27 || ch == ('g' & 0x1f)) {
+            prompt_done = nullptr;
+        } else if (ch == KEY_BACKSPACE || ch == 127) {
+            if (!prompt_input.empty()) prompt_input.pop_back();
+        } else if (ch < 0x80 && isprint(ch)) {
+            prompt_input += static_cast<char>(ch);
+        }
+    }
+
+    /**
+     * Draws the open prompt over the bottom status bar, with the
+     * hardware cursor after the typed text
+     */
+    void Editor::draw_prompt() {
+        int rows, cols;
+        getmaxyx(stdscr, rows, cols);
+        attron(A_BOLD);
+        mvhline(rows - 1, 0, ' ', cols);
+        mvprintw(rows - 1, 0, " %s%s", prompt_label.c_str(), prompt_input.c_str());
+        attroff(A_BOLD);
+    }
+
+    /**
+     * Reads a byte offset typed as decimal, or as hex after a 0x prefix
+     * 
+     * Throws std::logic_error (as std::stoull does) when it is not a number.
+     */
+    size_t Editor::parse_offset(const std::string& text) {
+        if (text.size() >= 2 && text[0] == '0' && (text[1] == 'x' || text[1] == 'X')) {
+            return std::stoull(text.substr(2), nullptr, 16);
+        }
+        return std::stoull(text, nullptr, 10);
+    }
+
+    /**
+     * Moves the cursor to "N" (1-based line) or "@N" (byte offset,
+     * decimal or 0x-prefixed hex), opening a fold the target is in and
+     * scrolling to it. Invalid input is ignored.
+     */
+    void Editor::go_to(const std::string& target) {
+        if (target.empty()) return;
+
+        try {
+            if (target[0] == '@') {
+                cursor().go_to_offset(buffer, parse_offset(target.substr(1)));
+            } else {
+                cursor().go_to_line(buffer, std::stoi(target) - 1);
+            }
+        } catch (const std::logic_error&) {
+            // Not a number, leave the cursor where it is
+            return;
+        }
+        viewport().reveal(cursor().position().first);
+        scroll_to_cursor();
     }
 };
\ No newline at end of file
@@ -0,0 +1,181 @@
+#include <poll.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <cerrno>
+#include <algorithm>
+
+#include "event_loop.hpp"
+
+namespace Var {
+
+    /**
+     * Sets up the signalfd and the completion eventfd
+     *
+     * SIGWINCH is blocked for the calling thread (and every thread it
+     * starts afterwards), so terminal resizes arrive as readable events
+     * instead of interrupting whatever the editor is doing.
+     */
+    EventLoop::EventLoop() {
+        sigset_t mask;
+        sigemptyset(&mask);
+        sigaddset(&mask, SIGWINCH);
+        pthread_sigmask(SIG_BLOCK, &mask, nullptr);
+
+        signal_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+        wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    }
+
+    EventLoop::~EventLoop() {
+        if (signal_fd >= 0) close(signal_fd);
+        if (wake_fd >= 0) close(wake_fd);
+    }
+
+    void EventLoop::watch(int fd, Callback on_readable) {
+        watchers[fd] = std::move(on_readable);
+    }
+
+    void EventLoop::unwatch(int fd) {
+        watchers.erase(fd);
+    }
+
+    /**
+     * Schedules callback after interval_ms, and every interval_ms after
+     * that when repeat is set. Returns an id for cancel_timer().
+     */
+    int EventLoop::add_timer(int interval_ms, Callback callback, bool repeat) {
+        const int id = next_timer_id++;
+        const std::chrono::milliseconds interval(interval_ms);
+        timers[id] = {Clock::now() + interval, interval, std::move(callback), repeat};
+        return id;
+    }
+
+    void EventLoop::cancel_timer(int id) {
+        timers.erase(id);
+    }
+
+    void EventLoop::on_resize(Callback callback) {
+        resize_callback = std::move(callback);
+    }
+
+    /**
+     * Queues a callback to run on the loop thread
+     *
+     * Safe to call from worker threads; wakes the loop through the
+     * eventfd so completions are handled without waiting for input.
+     */
+    void EventLoop::post(Callback completion) {
+        {
+            std::lock_guard<std::mutex> lock(completions_mutex);
+            completions.push_back(std::move(completion));
+        }
+
+        const uint64_t one = 1;
+        ssize_t written = write(wake_fd, &one, sizeof(one));
+        (void)written;
+    }
+
+    /**
+     * Waits for the next batch of events and dispatches them
+     *
+     * Blocks in poll() until a watched fd is readable, a signal or
+     * completion arrives, or the nearest timer is due.
+     */
+    void EventLoop::run_once() {
+        std::vector<pollfd> fds;
+        fds.push_back({wake_fd, POLLIN, 0});
+        fds.push_back({signal_fd, POLLIN, 0});
+        for (const auto& [fd, _] : watchers) {
+            fds.push_back({fd, POLLIN, 0});
+        }
+
+        const int ready = poll(fds.data(), fds.size(), poll_timeout());
+        if (ready < 0 && errno != EINTR) return;
+
+        if (ready > 0) {
+            if (fds[1].revents & POLLIN) {
+                drain_signals();
+            }
+
+            for (size_t i = 2; i < fds.size(); ++i) {
+                if (!(fds[i].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+
+                // A previous callback may have removed this watcher
+                const auto it = watchers.find(fds[i].fd);
+                if (it != watchers.end()) {
+                    Callback callback = it->second;
+                    callback();
+                }
+            }
+
+            if (fds[0].revents & POLLIN) {
+                drain_completions();
+            }
+        }
+
+        run_due_timers();
+    }
+
+    int EventLoop::poll_timeout() const {
+        if (timers.empty()) return -1;
+
+        Clock::time_point nearest = Clock::time_point::max();
+        for (const auto& [_, timer] : timers) {
+            nearest = std::min(nearest, timer.deadline);
+        }
+
+        const auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(nearest - Clock::now());
+        return static_cast<int>(std::max<int64_t>(wait.count(), 0));
+    }
+
+    void EventLoop::run_due_timers() {
+        const Clock::time_point now = Clock::now();
+
+        std::vector<int> due;
+        for (const auto& [id, timer] : timers) {
+            if (timer.deadline <= now) due.push_back(id);
+        }
+
+        for (const int id : due) {
+            const auto it = timers.find(id);
+            if (it == timers.end()) continue;
+
+            Callback callback = it->second.callback;
+            if (it->second.repeat) {
+                it->second.deadline = now + it->second.interval;
+            } else {
+                timers.erase(it);
+            }
+            callback();
+        }
+    }
+
+    void EventLoop::drain_signals() {
+        signalfd_siginfo info;
+        bool resized = false;
+        while (read(signal_fd, &info, sizeof(info)) == sizeof(info)) {
+            resized |= info.ssi_signo == SIGWINCH;
+        }
+
+        if (resized && resize_callback) {
+            resize_callback();
+        }
+    }
+
+    void EventLoop::drain_completions() {
+        uint64_t count;
+        ssize_t drained = read(wake_fd, &count, sizeof(count));
+        (void)drained;
+
+        std::deque<Callback> ready;
+        {
+            std::lock_guard<std::mutex> lock(completions_mutex);
+            ready.swap(completions);
+        }
+
+        for (auto& completion : ready) {
+            completion();
+        }
+    }
+}
@@ -0,0 +1,160 @@
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <algorithm>
+
+#include "file_follower.hpp"
+
+namespace Var {
+
+    FileFollower::~FileFollower() {
+        stop();
+    }
+
+    /**
+     * Starts following file_path, whose first known_size bytes the
+     * caller already has
+     *
+     * Throws std::runtime_error if the file or inotify cannot be opened.
+     */
+    void FileFollower::start(const std::string& file_path, off_t known_size) {
+        stop();
+        path = file_path;
+
+        notify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (notify_fd < 0) {
+            throw std::runtime_error(std::string("Unable to watch file: ") + strerror(errno));
+        }
+
+        open_file();
+        offset = known_size;
+        behind = false;
+    }
+
+    void FileFollower::stop() {
+        close_file();
+        if (notify_fd >= 0) {
+            close(notify_fd);
+            notify_fd = -1;
+        }
+    }
+
+    bool FileFollower::active() const {
+        return notify_fd >= 0;
+    }
+
+    /**
+     * Descriptor that becomes readable when the file may have changed
+     */
+    int FileFollower::descriptor() const {
+        return notify_fd;
+    }
+
+    /**
+     * Discards queued inotify events
+     *
+     * Events only say that something happened; read_changes() finds out
+     * what from the file itself.
+     */
+    void FileFollower::drain_notifications() {
+        alignas(inotify_event) char events[4096];
+        while (read(notify_fd, events, sizeof(events)) > 0) {
+        }
+    }
+
+    /**
+     * Reads what happened to the file since the last call
+     *
+     * Appended: text holds the new bytes (at most MAX_READ of them,
+     * has_more() tells whether another call would return more).
+     * Replaced: the file was truncated or rotated and text holds its
+     * new content.
+     */
+    FileFollower::Change FileFollower::read_changes(std::string& text) {
+        text.clear();
+        if (!active()) return Change::None;
+
+        // Rotation: the path now leads to another file
+        struct stat current;
+        bool replaced = false;
+        if (stat(path.c_str(), &current) == 0 && (current.st_dev != device || current.st_ino != inode)) {
+            close_file();
+            open_file();
+            replaced = true;
+        }
+
+        struct stat info;
+        if (fd < 0 || fstat(fd, &info) != 0) return Change::None;
+
+        // Truncation: the file is shorter than what was already read
+        if (info.st_size < offset) {
+            replaced = true;
+        }
+        if (replaced) {
+            offset = 0;
+        }
+
+        const size_t wanted = std::min(static_cast<size_t>(std::max<off_t>(info.st_size - offset, 0)), MAX_READ);
+        text.resize(wanted);
+        size_t got = 0;
+        while (got < wanted) {
+            const ssize_t count = pread(fd, text.data() + got, wanted - got, offset + got);
+            if (count <= 0) break;
+            got += static_cast<size_t>(count);
+        }
+        text.resize(got);
+        offset += static_cast<off_t>(got);
+        behind = offset < info.st_size;
+
+        if (replaced) return Change::Replaced;
+        return got > 0 ? Change::Appended : Change::None;
+    }
+
+    /**
+     * The file was just rewritten with size bytes the caller already
+     * has; reading goes on from there instead of taking them for an
+     * append
+     */
+    void FileFollower::saved(off_t size) {
+        if (!active()) return;
+
+        close_file();
+        open_file();
+        offset = size;
+        behind = false;
+    }
+
+    bool FileFollower::has_more() const {
+        return behind;
+    }
+
+    void FileFollower::open_file() {
+        fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            throw std::runtime_error("Unable to open file: " + path);
+        }
+
+        struct stat info;
+        fstat(fd, &info);
+        device = info.st_dev;
+        inode = info.st_ino;
+
+        notify_watch = inotify_add_watch(notify_fd, path.c_str(),
+                                         IN_MODIFY | IN_ATTRIB | IN_MOVE_SELF | IN_DELETE_SELF);
+    }
+
+    void FileFollower::close_file() {
+        if (notify_watch >= 0) {
+            inotify_rm_watch(notify_fd, notify_watch);
+            notify_watch = -1;
+        }
+        if (fd >= 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+}
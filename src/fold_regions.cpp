@@ -0,0 +1,92 @@
+#include <algorithm>
+
+#include "fold_regions.hpp"
+
+namespace Var {
+
+    /**
+     * Region headed by line: brackets first, then indentation
+     */
+    std::pair<int, int> FoldRegions::at(const Buffer& buffer, const BracketIndex& brackets, int line) {
+        const std::pair<int, int> region = bracket_region(buffer, brackets, line);
+        if (region.first >= 0) return region;
+        return indent_region(buffer, line);
+    }
+
+    /**
+     * Region headed by line, or else the indentation block line is in
+     *
+     * Walks up to the nearest less indented line, so the cost is the
+     * distance to that header.
+     */
+    std::pair<int, int> FoldRegions::enclosing(const Buffer& buffer, const BracketIndex& brackets, int line) {
+        const std::pair<int, int> own = at(buffer, brackets, line);
+        if (own.first >= 0) return own;
+
+        const int indent = indent_of(buffer.get_line(line));
+        if (indent <= 0) return {-1, -1};
+
+        for (int header = line - 1; header >= 0; --header) {
+            const int header_indent = indent_of(buffer.get_line(header));
+            if (header_indent >= 0 && header_indent < indent) {
+                const std::pair<int, int> region = indent_region(buffer, header);
+                return region.second >= line ? region : std::pair<int, int>{-1, -1};
+            }
+        }
+        return {-1, -1};
+    }
+
+    /**
+     * Region of the outermost bracket left open at the end of line:
+     * the first opener whose match lies on a later line
+     */
+    std::pair<int, int> FoldRegions::bracket_region(const Buffer& buffer, const BracketIndex& brackets, int line) {
+        const std::string_view text = buffer.get_line(line);
+        const size_t line_start = buffer.line_offset(line);
+        const size_t line_end = line_start + text.size();
+
+        for (size_t i = 0; i < text.size(); ++i) {
+            if (text[i] != '{' && text[i] != '[' && text[i] != '(') continue;
+
+            const size_t match = brackets.match(buffer, line_start + i);
+            if (match == BracketIndex::NONE || match < line_end) continue;
+
+            const int closing_line = buffer.find_line_for_position(match);
+            if (closing_line - 1 <= line) return {-1, -1};
+            return {line, closing_line - 1};
+        }
+        return {-1, -1};
+    }
+
+    std::pair<int, int> FoldRegions::indent_region(const Buffer& buffer, int line) {
+        const int indent = indent_of(buffer.get_line(line));
+        if (indent < 0) return {-1, -1};
+
+        int last = line;
+        for (int next = line + 1; next < buffer.line_count(); ++next) {
+            const int next_indent = indent_of(buffer.get_line(next));
+            if (next_indent < 0) continue;
+            if (next_indent <= indent) break;
+            last = next;
+        }
+        if (last == line) return {-1, -1};
+        return {line, last};
+    }
+
+    /**
+     * Leading whitespace width (tabs count as 4), -1 for blank lines
+     */
+    int FoldRegions::indent_of(std::string_view line) {
+        int width = 0;
+        for (const char ch : line) {
+            if (ch == ' ') {
+                ++width;
+            } else if (ch == '\t') {
+                width += 4;
+            } else {
+                return width;
+            }
+        }
+        return -1;
+    }
+}
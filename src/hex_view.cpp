@@ -0,0 +1,327 @@
+#include <ncurses.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <algorithm>
+
+#include "hex_view.hpp"
+
+namespace Var {
+
+    HexView::~HexView() {
+        close();
+    }
+
+    /**
+     * Guesses whether a file is binary from its first SNIFF_BYTES
+     *
+     * A NUL byte decides it, as does a high share of control
+     * characters other than the usual whitespace and escape. Bytes
+     * above 0x7f count as text so UTF-8 files stay in the text view.
+     */
+    bool HexView::is_binary(const std::string& file_path) {
+        const int fd = ::open(file_path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return false;
+
+        unsigned char sample[SNIFF_BYTES];
+        const ssize_t length = read(fd, sample, sizeof(sample));
+        ::close(fd);
+        if (length <= 0) return false;
+
+        size_t control = 0;
+        for (ssize_t i = 0; i < length; ++i) {
+            const unsigned char byte = sample[i];
+            if (byte == 0) return true;
+            if (byte < 0x20 && !strchr("\t\n\r\f\v\b\033", byte)) ++control;
+        }
+        return control * 10 > static_cast<size_t>(length);
+    }
+
+    /**
+     * Maps file_path read-only and shows it from the start
+     *
+     * Throws std::runtime_error if the file cannot be opened or mapped.
+     */
+    void HexView::open(const std::string& file_path) {
+        close();
+
+        const int fd = ::open(file_path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            throw std::runtime_error("Unable to open file: " + file_path);
+        }
+
+        struct stat info;
+        if (fstat(fd, &info) < 0) {
+            ::close(fd);
+            throw std::runtime_error("Unable to open file: " + file_path);
+        }
+
+        size = static_cast<size_t>(info.st_size);
+        if (size > 0) {
+            void* mapping = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+            if (mapping == MAP_FAILED) {
+                const std::string reason = strerror(errno);
+                ::close(fd);
+                size = 0;
+                throw std::runtime_error("Unable to map file: " + reason);
+            }
+            data = static_cast<const unsigned char*>(mapping);
+        }
+        ::close(fd); // the mapping stays valid without the descriptor
+
+        path = file_path;
+        cursor = 0;
+        low_nibble = false;
+        top_row = 0;
+    }
+
+    void HexView::close() {
+        if (data) {
+            munmap(const_cast<unsigned char*>(data), size);
+            data = nullptr;
+        }
+        size = 0;
+        patches.clear();
+        path.clear();
+    }
+
+    bool HexView::active() const {
+        return !path.empty();
+    }
+
+    bool HexView::modified() const {
+        return !patches.empty();
+    }
+
+    unsigned char HexView::byte_at(size_t offset) const {
+        const auto patch = patches.find(offset);
+        return patch != patches.end() ? patch->second : data[offset];
+    }
+
+    size_t HexView::row_count() const {
+        return std::max<size_t>((size + BYTES_PER_ROW - 1) / BYTES_PER_ROW, 1);
+    }
+
+    /**
+     * Width of the offset column: 8 hex digits, more for files past 4 GiB
+     */
+    int HexView::offset_digits() const {
+        int digits = 8;
+        while (digits < 16 && (size >> (4 * digits)) != 0) ++digits;
+        return digits;
+    }
+
+    void HexView::scroll_to_cursor() {
+        const size_t cursor_row = cursor / BYTES_PER_ROW;
+        if (cursor_row < top_row) {
+            top_row = cursor_row;
+        } else if (cursor_row >= top_row + text_rows) {
+            top_row = cursor_row - text_rows + 1;
+        }
+    }
+
+    /**
+     * Draws the whole screen into stdscr; the caller refreshes
+     */
+    void HexView::draw(const std::string& filename) {
+        int height, width;
+        getmaxyx(stdscr, height, width);
+        text_rows = std::max(height - 1, 1);
+        scroll_to_cursor();
+
+        const int offset_width = offset_digits();
+        for (int screen_row = 0; screen_row < height - 1; ++screen_row) {
+            draw_row(top_row + screen_row, screen_row, offset_width, width);
+        }
+        draw_status_bar(filename, height - 1, width);
+
+        // Hardware cursor on the digit or character being typed over
+        const int column = static_cast<int>(cursor % BYTES_PER_ROW);
+        const int hex_col = offset_width + 2 + column * 3 + (column >= 8 ? 1 : 0) + (low_nibble ? 1 : 0);
+        const int ascii_col = offset_width + 2 + BYTES_PER_ROW * 3 + 2 + column;
+        wmove(stdscr, static_cast<int>(cursor / BYTES_PER_ROW - top_row), std::min(ascii_side ? ascii_col : hex_col, width - 1));
+    }
+
+    /**
+     * Renders one row: offset, BYTES_PER_ROW hex pairs (split in two
+     * groups of eight) and the same bytes as ASCII
+     *
+     * Overwritten bytes are bold; the byte under the cursor is shown
+     * reversed in the column that is not being typed in.
+     */
+    void HexView::draw_row(size_t row, int screen_row, int offset_width, int width) const {
+        wmove(stdscr, screen_row, 0);
+        clrtoeol();
+        if (row >= row_count() || size == 0) return;
+
+        const size_t start = row * BYTES_PER_ROW;
+        const size_t count = std::min<size_t>(BYTES_PER_ROW, size - start);
+        auto put = [&](int col, chtype ch) {
+            if (col < width) mvaddch(screen_row, col, ch);
+        };
+
+        char offset[17];
+        snprintf(offset, sizeof(offset), "%0*zx", offset_width, start);
+        attron(A_DIM);
+        mvaddnstr(screen_row, 0, offset, width);
+        attroff(A_DIM);
+
+        static const char digits[] = "0123456789abcdef";
+        const int hex_start = offset_width + 2;
+        const int ascii_start = hex_start + BYTES_PER_ROW * 3 + 2;
+        for (size_t i = 0; i < count; ++i) {
+            const size_t offset_i = start + i;
+            const unsigned char byte = byte_at(offset_i);
+            const chtype changed = patches.count(offset_i) ? A_BOLD : 0;
+            const chtype hex_cursor = offset_i == cursor && ascii_side ? A_REVERSE : 0;
+            const chtype ascii_cursor = offset_i == cursor && !ascii_side ? A_REVERSE : 0;
+
+            const int hex_col = hex_start + static_cast<int>(i) * 3 + (i >= 8 ? 1 : 0);
+            put(hex_col, digits[byte >> 4] | changed | hex_cursor);
+            put(hex_col + 1, digits[byte & 0x0f] | changed | hex_cursor);
+
+            const bool printable = byte >= 0x20 && byte < 0x7f;
+            put(ascii_start + static_cast<int>(i), (printable ? byte : '.') | changed | ascii_cursor | (printable ? 0 : A_DIM));
+        }
+    }
+
+    void HexView::draw_status_bar(const std::string& filename, int row, int width) const {
+        attron(COLOR_PAIR(1) | A_BOLD);
+        mvhline(row, 0, ' ', width);
+        mvprintw(row, 0, " %s | 0x%zx/0x%zx | %s %s",
+            filename.c_str(), cursor, size,
+            ascii_side ? "ASCII" : "HEX",
+            modified() ? "[+]" : "");
+        if (!message.empty()) {
+            printw(" | %s", message.c_str());
+        }
+
+        const std::string version = "VAR 1.1";
+        if (getcurx(stdscr) < width - static_cast<int>(version.length()) - 1) {
+            mvprintw(row, width - version.length() - 1, "%s", version.c_str());
+        }
+        attroff(COLOR_PAIR(1) | A_BOLD);
+    }
+
+    /**
+     * Moves the cursor by delta bytes, stopping at either end
+     */
+    void HexView::move_by(long long delta) {
+        const long long target = static_cast<long long>(cursor) + delta;
+        move_to(static_cast<size_t>(std::max(target, 0LL)));
+    }
+
+    void HexView::move_to(size_t offset) {
+        cursor = size == 0 ? 0 : std::min(offset, size - 1);
+        low_nibble = false;
+    }
+
+    /**
+     * Scrolls by one screenful, the cursor keeping its place on screen
+     */
+    void HexView::page(int direction) {
+        const size_t rows = static_cast<size_t>(text_rows);
+        const size_t last_top = row_count() > rows ? row_count() - rows : 0;
+        if (direction < 0) {
+            top_row = top_row > rows ? top_row - rows : 0;
+        } else {
+            top_row = std::min(top_row + rows, last_top);
+        }
+        move_by(static_cast<long long>(direction) * text_rows * BYTES_PER_ROW);
+    }
+
+    void HexView::move_to_row_start() {
+        move_to(cursor - cursor % BYTES_PER_ROW);
+    }
+
+    void HexView::move_to_row_end() {
+        move_to(cursor - cursor % BYTES_PER_ROW + BYTES_PER_ROW - 1);
+    }
+
+    /**
+     * Switches typing between the hex digits and the ASCII column
+     */
+    void HexView::toggle_side() {
+        ascii_side = !ascii_side;
+        low_nibble = false;
+    }
+
+    /**
+     * Overwrites the byte at the cursor with a typed key
+     *
+     * In the hex column a digit replaces one half of the byte and the
+     * cursor advances after the second; in the ASCII column a printable
+     * character replaces the whole byte. Returns false for keys that do
+     * not edit.
+     */
+    bool HexView::overwrite(int ch) {
+        if (size == 0) return false;
+
+        unsigned char byte = byte_at(cursor);
+        if (ascii_side) {
+            if (ch < 0x20 || ch >= 0x7f) return false;
+            byte = static_cast<unsigned char>(ch);
+        } else {
+            if (ch > 0xff || !isxdigit(ch)) return false;
+            const unsigned char digit = isdigit(ch) ? ch - '0' : tolower(ch) - 'a' + 10;
+            byte = low_nibble ? (byte & 0xf0) | digit : (byte & 0x0f) | (digit << 4);
+        }
+
+        // Typing the original value back drops the overwrite
+        if (byte == data[cursor]) {
+            patches.erase(cursor);
+        } else {
+            patches[cursor] = byte;
+        }
+
+        if (ascii_side || low_nibble) {
+            move_by(1);
+        } else {
+            low_nibble = true;
+        }
+        return true;
+    }
+
+    /**
+     * Writes the overwritten bytes back to their offsets in the file
+     *
+     * Runs of adjacent bytes go out in one write. The shared mapping
+     * shows the new content right away.
+     * Throws std::runtime_error if the file cannot be written.
+     */
+    void HexView::save() {
+        if (patches.empty()) return;
+
+        const int fd = ::open(path.c_str(), O_WRONLY | O_CLOEXEC);
+        if (fd < 0) {
+            throw std::runtime_error("Failed to open file for writing: " + path);
+        }
+
+        auto patch = patches.begin();
+        while (patch != patches.end()) {
+            const size_t start = patch->first;
+            std::string run;
+            while (patch != patches.end() && patch->first == start + run.size()) {
+                run += static_cast<char>(patch->second);
+                ++patch;
+            }
+            if (pwrite(fd, run.data(), run.size(), static_cast<off_t>(start)) != static_cast<ssize_t>(run.size())) {
+                const std::string reason = strerror(errno);
+                ::close(fd);
+                throw std::runtime_error("Failed to write file: " + reason);
+            }
+        }
+
+        ::close(fd);
+        patches.clear();
+    }
+
+    void HexView::set_message(const std::string& text) {
+        message = text;
+    }
+}
@@ -0,0 +1,176 @@
+#include <algorithm>
+#include <cstring>
+
+#include "line_index.hpp"
+
+namespace Var {
+
+    LineIndex::LineIndex(size_t budget) : budget(budget) {}
+
+    /**
+     * Adopts a complete list of line offsets, compacting it if it is
+     * over budget
+     */
+    void LineIndex::assign(std::vector<size_t>&& line_offsets) {
+        clear();
+        offsets = std::move(line_offsets);
+        if (offsets.size() * sizeof(size_t) > budget) {
+            make_compact();
+        }
+    }
+
+    void LineIndex::clear() {
+        offsets.clear();
+        checkpoints.clear();
+        lines = 0;
+        compact = false;
+        forget_blocks_from(0);
+    }
+
+    void LineIndex::push_back(size_t offset) {
+        if (!compact) {
+            offsets.push_back(offset);
+            if (offsets.size() * sizeof(size_t) > budget) {
+                make_compact();
+            }
+            return;
+        }
+
+        // The tail block's cached copy is refreshed by its line count
+        if (lines % BLOCK_LINES == 0) {
+            checkpoints.push_back(offset);
+        }
+        ++lines;
+    }
+
+    /**
+     * Drops every line from line_count on
+     */
+    void LineIndex::truncate(size_t line_count) {
+        if (!compact) {
+            offsets.resize(std::min(line_count, offsets.size()));
+            return;
+        }
+
+        lines = std::min(line_count, lines);
+        checkpoints.resize((lines + BLOCK_LINES - 1) / BLOCK_LINES);
+        forget_blocks_from(lines > 0 ? (lines - 1) / BLOCK_LINES : 0);
+    }
+
+    size_t LineIndex::size() const {
+        return compact ? lines : offsets.size();
+    }
+
+    bool LineIndex::empty() const {
+        return size() == 0;
+    }
+
+    bool LineIndex::is_compact() const {
+        return compact;
+    }
+
+    /**
+     * Start offset of line
+     *
+     * O(1) in dense mode and for checkpoint lines; other lines cost a
+     * cache lookup, plus one block scan on a miss.
+     */
+    size_t LineIndex::offset(const std::string& text, size_t line) const {
+        if (!compact) return offsets[line];
+
+        const size_t block = line / BLOCK_LINES;
+        const size_t in_block = line % BLOCK_LINES;
+        if (in_block == 0) return checkpoints[block];
+
+        std::lock_guard<std::mutex> lock(cache_mutex);
+        const DecodedBlock& decoded = decode(text, block);
+        return in_block < decoded.offsets.size() ? decoded.offsets[in_block] : text.size();
+    }
+
+    /**
+     * Line containing byte position pos: the last line starting at or
+     * before it
+     */
+    size_t LineIndex::line_of(const std::string& text, size_t pos) const {
+        if (!compact) {
+            const auto next = std::upper_bound(offsets.begin(), offsets.end(), pos);
+            return next == offsets.begin() ? 0 : static_cast<size_t>(next - offsets.begin()) - 1;
+        }
+        if (checkpoints.empty()) return 0;
+
+        const auto next_block = std::upper_bound(checkpoints.begin(), checkpoints.end(), pos);
+        const size_t block = next_block == checkpoints.begin() ? 0 : static_cast<size_t>(next_block - checkpoints.begin()) - 1;
+
+        std::lock_guard<std::mutex> lock(cache_mutex);
+        const DecodedBlock& decoded = decode(text, block);
+        const auto next = std::upper_bound(decoded.offsets.begin(), decoded.offsets.end(), pos);
+        return block * BLOCK_LINES + std::max<size_t>(next - decoded.offsets.begin(), 1) - 1;
+    }
+
+    /**
+     * All offsets as a plain vector (decodes everything in compact mode)
+     */
+    std::vector<size_t> LineIndex::to_vector(const std::string& text) const {
+        if (!compact) return offsets;
+
+        std::vector<size_t> all;
+        all.reserve(lines);
+        for (size_t line = 0; line < lines; ++line) {
+            all.push_back(offset(text, line));
+        }
+        return all;
+    }
+
+    /**
+     * Returns the cached offsets of a block, scanning the text on a miss
+     *
+     * A cached tail block with fewer lines than the block now has is
+     * stale (lines were appended) and is decoded again. Caller holds
+     * cache_mutex.
+     */
+    const LineIndex::DecodedBlock& LineIndex::decode(const std::string& text, size_t block) const {
+        DecodedBlock& slot = cache[block % cache.size()];
+        const size_t wanted = lines_in_block(block);
+        if (slot.block == block && slot.offsets.size() == wanted) return slot;
+
+        slot.block = block;
+        slot.offsets.clear();
+        size_t pos = checkpoints[block];
+        slot.offsets.push_back(pos);
+        while (slot.offsets.size() < wanted) {
+            const void* newline = memchr(text.data() + pos, '\n', text.size() - std::min(pos, text.size()));
+            if (newline == nullptr) break;
+
+            pos = static_cast<const char*>(newline) - text.data() + 1;
+            slot.offsets.push_back(pos);
+        }
+        return slot;
+    }
+
+    size_t LineIndex::lines_in_block(size_t block) const {
+        return std::min(BLOCK_LINES, lines - block * BLOCK_LINES);
+    }
+
+    void LineIndex::make_compact() {
+        lines = offsets.size();
+        checkpoints.clear();
+        checkpoints.reserve((lines + BLOCK_LINES - 1) / BLOCK_LINES);
+        for (size_t line = 0; line < lines; line += BLOCK_LINES) {
+            checkpoints.push_back(offsets[line]);
+        }
+
+        offsets.clear();
+        offsets.shrink_to_fit();
+        compact = true;
+        forget_blocks_from(0);
+    }
+
+    void LineIndex::forget_blocks_from(size_t block) {
+        std::lock_guard<std::mutex> lock(cache_mutex);
+        for (DecodedBlock& slot : cache) {
+            if (slot.block != SIZE_MAX && slot.block >= block) {
+                slot.block = SIZE_MAX;
+            }
+        }
+    }
+}
@@ -0,0 +1,285 @@
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+
+#include "line_index_cache.hpp"
+
+namespace fs = std::filesystem;
+
+namespace Var {
+
+    namespace {
+        constexpr char MAGIC[8] = {'V', 'A', 'R', 'I', 'D', 'X', '1', '\0'};
+
+        uint64_t fnv1a(uint64_t hash, const char* data, size_t size) {
+            for (size_t i = 0; i < size; ++i) {
+                hash ^= static_cast<unsigned char>(data[i]);
+                hash *= 0x100000001b3ull;
+            }
+            return hash;
+        }
+
+        template <typename T>
+        void write_pod(std::ostream& out, const T& value) {
+            out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+        }
+
+        template <typename T>
+        bool read_pod(std::istream& in, T& value) {
+            return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(value)));
+        }
+
+        void write_varint(std::ostream& out, uint64_t value) {
+            while (value >= 0x80) {
+                out.put(static_cast<char>((value & 0x7f) | 0x80));
+                value >>= 7;
+            }
+            out.put(static_cast<char>(value));
+        }
+
+        bool read_varint(std::istream& in, uint64_t& value) {
+            value = 0;
+            for (int shift = 0; shift < 64; shift += 7) {
+                const int byte = in.get();
+                if (byte == EOF) return false;
+
+                value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+                if (!(byte & 0x80)) return true;
+            }
+            return false;
+        }
+    }
+
+    /**
+     * Resolves the cache directory
+     *
+     * $XDG_CACHE_HOME/var, or ~/.cache/var. With neither variable set the
+     * cache stays disabled.
+     */
+    LineIndexCache::LineIndexCache(uint64_t max_bytes) : max_bytes(max_bytes) {
+        if (const char* xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg) {
+            directory = std::string(xdg) + "/var";
+        } else if (const char* home = std::getenv("HOME"); home && *home) {
+            directory = std::string(home) + "/.cache/var";
+        }
+    }
+
+    bool LineIndexCache::FileIdentity::operator==(const FileIdentity& other) const {
+        return path == other.path && size == other.size && mtime_ns == other.mtime_ns && sample_hash == other.sample_hash;
+    }
+
+    /**
+     * Looks up a still-valid entry for file_path
+     *
+     * identity receives the file's identity before its content is
+     * read, hit or miss, to be handed back to store(); its path stays
+     * empty if the file cannot be identified. Returns false on a miss,
+     * a stale entry or any read error.
+     */
+    bool LineIndexCache::load(const std::string& file_path, CachedView& view, FileIdentity& identity) const {
+        identity = FileIdentity{};
+        if (directory.empty() || !identify(file_path, identity)) {
+            identity = FileIdentity{};
+            return false;
+        }
+
+        const std::string entry = entry_path(identity.path);
+        std::ifstream in(entry, std::ios::binary);
+        if (!in) return false;
+
+        char magic[sizeof(MAGIC)];
+        uint64_t size, sample_hash, path_length, line_count;
+        int64_t mtime_ns;
+        if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0) return false;
+        if (!read_pod(in, size) || !read_pod(in, mtime_ns) || !read_pod(in, sample_hash)) return false;
+        if (size != identity.size || mtime_ns != identity.mtime_ns || sample_hash != identity.sample_hash) return false;
+
+        if (!read_pod(in, path_length) || path_length != identity.path.size()) return false;
+        std::string path(path_length, '\0');
+        if (!in.read(path.data(), path_length) || path != identity.path) return false;
+
+        CachedView cached;
+        if (!read_pod(in, cached.cursor_line) || !read_pod(in, cached.cursor_col) || !read_pod(in, cached.top_line)) return false;
+        if (!read_pod(in, line_count) || line_count == 0 || line_count > size + 1) return false;
+
+        // Offsets are stored as deltas; every line but the first starts after a newline
+        cached.line_offsets.reserve(line_count);
+        uint64_t offset = 0;
+        for (uint64_t i = 0; i < line_count; ++i) {
+            uint64_t delta;
+            if (!read_varint(in, delta)) return false;
+            if (i > 0 && delta == 0) return false;
+
+            offset += delta;
+            if (offset > size || (i > 0 && offset == size)) return false;
+            cached.line_offsets.push_back(offset);
+        }
+        if (cached.line_offsets.front() != 0) return false;
+
+        // Mark as recently used
+        std::error_code ignored;
+        fs::last_write_time(entry, fs::file_time_type::clock::now(), ignored);
+
+        view = std::move(cached);
+        return true;
+    }
+
+    /**
+     * Saves the index and view position for file_path
+     *
+     * view.line_offsets describe the file as it was when load() gave
+     * out loaded; nothing is written if the file changed since.
+     * Writes through a temporary file and rename so readers never see
+     * a partial entry, then trims the cache back under its budget.
+     */
+    void LineIndexCache::store(const std::string& file_path, const CachedView& view, const FileIdentity& loaded) const {
+        FileIdentity identity;
+        if (directory.empty() || view.line_offsets.empty() || loaded.path.empty()) return;
+        if (!identify(file_path, identity) || !(identity == loaded)) return;
+
+        std::error_code error;
+        fs::create_directories(directory, error);
+        if (error) return;
+
+        const std::string entry = entry_path(identity.path);
+        const std::string temporary = entry + ".tmp" + std::to_string(getpid());
+        {
+            std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+            if (!out) return;
+
+            out.write(MAGIC, sizeof(MAGIC));
+            write_pod(out, identity.size);
+            write_pod(out, identity.mtime_ns);
+            write_pod(out, identity.sample_hash);
+            write_pod(out, static_cast<uint64_t>(identity.path.size()));
+            out.write(identity.path.data(), identity.path.size());
+            write_pod(out, view.cursor_line);
+            write_pod(out, view.cursor_col);
+            write_pod(out, view.top_line);
+            write_pod(out, static_cast<uint64_t>(view.line_offsets.size()));
+
+            size_t previous = 0;
+            for (const size_t offset : view.line_offsets) {
+                write_varint(out, offset - previous);
+                previous = offset;
+            }
+
+            if (!out.good()) {
+                out.close();
+                fs::remove(temporary, error);
+                return;
+            }
+        }
+
+        fs::rename(temporary, entry, error);
+        if (error) {
+            fs::remove(temporary, error);
+            return;
+        }
+        evict(entry);
+    }
+
+    /**
+     * Collects what an entry is validated against
+     *
+     * The sample hash covers SAMPLE_COUNT evenly spaced blocks (first and
+     * last included), so it costs the same for a 1 KB and a 10 GB file.
+     */
+    bool LineIndexCache::identify(const std::string& file_path, FileIdentity& identity) const {
+        std::error_code error;
+        const fs::path absolute = fs::absolute(file_path, error);
+        if (error) return false;
+
+        const int fd = open(absolute.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return false;
+
+        struct stat info;
+        if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+            close(fd);
+            return false;
+        }
+
+        identity.path = absolute.lexically_normal().string();
+        identity.size = static_cast<uint64_t>(info.st_size);
+        identity.mtime_ns = static_cast<int64_t>(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+
+        uint64_t hash = fnv1a(0xcbf29ce484222325ull, reinterpret_cast<const char*>(&identity.size), sizeof(identity.size));
+        char sample[SAMPLE_SIZE];
+        const uint64_t span = identity.size > SAMPLE_SIZE ? identity.size - SAMPLE_SIZE : 0;
+        for (int i = 0; i < SAMPLE_COUNT; ++i) {
+            const off_t offset = static_cast<off_t>(span * i / (SAMPLE_COUNT - 1));
+            const ssize_t got = pread(fd, sample, sizeof(sample), offset);
+            if (got < 0) {
+                close(fd);
+                return false;
+            }
+            hash = fnv1a(hash, sample, static_cast<size_t>(got));
+        }
+        identity.sample_hash = hash;
+
+        close(fd);
+        return true;
+    }
+
+    std::string LineIndexCache::entry_path(const std::string& absolute_path) const {
+        const uint64_t hash = fnv1a(0xcbf29ce484222325ull, absolute_path.data(), absolute_path.size());
+
+        char name[32];
+        snprintf(name, sizeof(name), "%016llx.idx", static_cast<unsigned long long>(hash));
+        return directory + "/" + name;
+    }
+
+    /**
+     * Removes least recently used entries until the cache fits max_bytes
+     *
+     * keep (the entry just written) is never evicted, even when it alone
+     * exceeds the budget.
+     */
+    void LineIndexCache::evict(const std::string& keep) const {
+        struct Entry {
+            fs::path path;
+            fs::file_time_type used;
+            uint64_t size;
+        };
+
+        // Entries that vanish or can't be inspected meanwhile are skipped;
+        // the error_code calls clear the error on success, so each one is
+        // checked on its own
+        std::error_code error;
+        std::vector<Entry> entries;
+        uint64_t total = 0;
+        for (fs::directory_iterator item(directory, error), end; !error && item != end; item.increment(error)) {
+            if (item->path().extension() != ".idx" || item->path() == keep) continue;
+
+            std::error_code item_error;
+            const uint64_t size = item->file_size(item_error);
+            if (item_error) continue;
+            const auto used = item->last_write_time(item_error);
+            if (item_error) continue;
+
+            entries.push_back({item->path(), used, size});
+            total += size;
+        }
+
+        const uint64_t kept_size = fs::file_size(keep, error);
+        if (!error) {
+            total += kept_size;
+        }
+
+        std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+            return a.used < b.used;
+        });
+
+        for (const auto& entry : entries) {
+            if (total <= max_bytes) break;
+            if (fs::remove(entry.path, error)) {
+                total -= entry.size;
+            }
+        }
+    }
+}
@@ -2,6 +2,7 @@
 
 #include <editor.hpp>
 #include <arguments.hpp>
+#include <batch.hpp>
 
 int main(int argc, char *argv[]) {
 
@@ -10,8 +11,32 @@ int main(int argc, char *argv[]) {
         return 1;
     }
 
-    if (argument.vec.size() > 0) {
+    if (!argument.batch_script.empty()) {
+        try {
+            return Var::BatchEditor(argument.batch_script).run(argument.vec);
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+    }
+
+    if (argument.vec.size() > 0 && argument.vec[0] == "-") {
+        try {
+            Var::Editor::get().open_stdin();
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+    } else if (argument.vec.size() > 0) {
         Var::Editor::get().load_file(argument.vec[0]);
+        if (argument.follow) {
+            try {
+                Var::Editor::get().follow();
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
+                return 1;
+            }
+        }
     }
     Var::Editor::get().run();
     
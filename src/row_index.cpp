@@ -0,0 +1,523 @@
+#include <algorithm>
+#include <iterator>
+
+#include "row_index.hpp"
+
+namespace Var {
+
+    /**
+     * Turns soft wrapping on for the given text width
+     *
+     * Every line starts with an estimated count of one row; real counts
+     * are filled in by measure() as lines become visible, so enabling is
+     * O(n) in line count and never touches the text itself.
+     */
+    void RowIndex::enable(const Buffer& buffer, int width) {
+        wrap = true;
+        wrap_width = std::max(width, 1);
+        rebuild(buffer);
+    }
+
+    /**
+     * Turns soft wrapping off
+     *
+     * The blocks are kept (with one row per line) while folds need it.
+     */
+    void RowIndex::disable(const Buffer& buffer) {
+        wrap = false;
+        if (folds.empty()) {
+            release();
+        } else {
+            rebuild(buffer);
+        }
+    }
+
+    bool RowIndex::active() const {
+        return enabled;
+    }
+
+    bool RowIndex::wrapping() const {
+        return wrap;
+    }
+
+    /**
+     * Changes wrap width
+     *
+     * O(1): all lines become stale and keep their old count as an
+     * estimate until they are measured again.
+     */
+    void RowIndex::set_width(int width) {
+        width = std::max(width, 1);
+        if (width == wrap_width) return;
+
+        wrap_width = width;
+        ++generation;
+    }
+
+    int RowIndex::width() const {
+        return wrap ? wrap_width : UNWRAPPED;
+    }
+
+    /**
+     * Resynchronises with the buffer after unannounced changes
+     *
+     * Edits reported through splice() keep the line count in step; a
+     * mismatch means the buffer was replaced, which also drops all folds.
+     */
+    void RowIndex::sync(const Buffer& buffer) {
+        if (lines == buffer.line_count()) return;
+
+        folds.clear();
+        if (wrap) {
+            rebuild(buffer);
+        } else {
+            release();
+            lines = buffer.line_count();
+        }
+    }
+
+    /**
+     * Brings one line's row count up to date with the current width
+     */
+    void RowIndex::measure(const Buffer& buffer, int line) {
+        if (!wrap || line < 0 || line >= lines) return;
+
+        const auto [block, at] = find_line(line);
+        if (blocks[block].measured_at[at] == generation) return;
+        set_count(block, at, count_rows(buffer, line));
+    }
+
+    /**
+     * Replaces old_count lines starting at first_line with new_count lines
+     *
+     * Only the edited lines are measured. When the line count stays the
+     * same this is a point update. Otherwise the lines are cut out of and
+     * put into their blocks, which costs O(MAX_BLOCK_LINES + log n) on
+     * top of the edited lines themselves. The trees over the blocks are
+     * rebuilt only when blocks are split or emptied before the last one,
+     * so at most once per BLOCK_LINES lines inserted into a block. Folds
+     * touching the edited lines are opened.
+     */
+    void RowIndex::splice(const Buffer& buffer, int first_line, int old_count, int new_count) {
+        if (!enabled) {
+            lines = buffer.line_count();
+            return;
+        }
+
+        if (old_count == new_count) {
+            for (int line = first_line; line < first_line + new_count && line < lines; ++line) {
+                const auto [block, at] = find_line(line);
+                set_count(block, at, count_rows(buffer, line));
+            }
+            return;
+        }
+
+        first_line = std::min(first_line, lines);
+        const int erase_end = std::min(first_line + old_count, lines);
+        drop_folds(first_line, erase_end - first_line, new_count);
+        if (!wrap && folds.empty()) {
+            release();
+            lines = buffer.line_count();
+            return;
+        }
+
+        const auto [first_block, at] = first_line < lines
+            ? find_line(first_line)
+            : std::make_pair(blocks.size() - 1, blocks.back().counts.size());
+
+        // Cut the old lines out of as many blocks as they span...
+        size_t last_block = first_block;
+        size_t offset = at;
+        for (int left = erase_end - first_line; left > 0;) {
+            Block& block = blocks[last_block];
+            const size_t cut = std::min(static_cast<size_t>(left), block.counts.size() - offset);
+            block.counts.erase(block.counts.begin() + offset, block.counts.begin() + offset + cut);
+            block.measured_at.erase(block.measured_at.begin() + offset, block.measured_at.begin() + offset + cut);
+            block.hidden.erase(block.hidden.begin() + offset, block.hidden.begin() + offset + cut);
+            left -= static_cast<int>(cut);
+            if (left > 0) {
+                ++last_block;
+                offset = 0;
+            }
+        }
+
+        // ...and put the new ones in where the first one was
+        std::vector<uint32_t> fresh(new_count);
+        for (int i = 0; i < new_count; ++i) {
+            fresh[i] = count_rows(buffer, first_line + i);
+        }
+        Block& block = blocks[first_block];
+        block.counts.insert(block.counts.begin() + at, fresh.begin(), fresh.end());
+        block.measured_at.insert(block.measured_at.begin() + at, new_count, generation);
+        block.hidden.insert(block.hidden.begin() + at, new_count, 0);
+        lines += new_count - (erase_end - first_line);
+
+        for (size_t edited = first_block; edited <= last_block; ++edited) {
+            recount(blocks[edited]);
+        }
+
+        const size_t old_blocks = blocks.size();
+        const bool at_end = last_block == old_blocks - 1;
+        const auto emptied = std::remove_if(blocks.begin() + first_block, blocks.begin() + last_block + 1,
+            [](const Block& edited) { return edited.counts.empty(); });
+        bool reshaped = emptied != blocks.begin() + last_block + 1;
+        blocks.erase(emptied, blocks.begin() + last_block + 1);
+        if (blocks.empty()) {
+            blocks.emplace_back();
+        }
+        if (first_block < blocks.size() && blocks[first_block].counts.size() > MAX_BLOCK_LINES) {
+            split(first_block);
+            reshaped = true;
+        }
+
+        if (!reshaped) {
+            refresh(first_block, last_block);
+        } else if (at_end && blocks.size() <= leaf_base) {
+            refresh(first_block, std::max(old_blocks, blocks.size()) - 1);
+        } else {
+            build_trees();
+        }
+    }
+
+    /**
+     * Rows a line occupies; 0 for lines inside a fold
+     */
+    int RowIndex::rows_of(int line) const {
+        if (!enabled) return 1;
+        if (line < 0 || line >= lines) return 0;
+
+        const auto [block, at] = find_line(line);
+        return blocks[block].hidden[at] ? 0 : static_cast<int>(blocks[block].counts[at]);
+    }
+
+    /**
+     * Returns the first visual row of a line (prefix sum over visible
+     * counts)
+     *
+     * Walks down to the line's block, adding the rows of the blocks
+     * passed on the left, then adds the visible lines before it in the
+     * block.
+     */
+    int RowIndex::row_of_line(int line) const {
+        if (!enabled) return line;
+
+        line = std::clamp(line, 0, lines);
+        if (line == lines) return total_rows();
+
+        uint32_t sum = 0;
+        uint32_t rest = static_cast<uint32_t>(line);
+        size_t node = 1;
+        while (node < leaf_base) {
+            if (line_tree[2 * node] > rest) {
+                node = 2 * node;
+            } else {
+                rest -= line_tree[2 * node];
+                sum += row_tree[2 * node];
+                node = 2 * node + 1;
+            }
+        }
+
+        const Block& block = blocks[node - leaf_base];
+        for (size_t at = 0; at < rest; ++at) {
+            if (!block.hidden[at]) sum += block.counts[at];
+        }
+        return static_cast<int>(sum);
+    }
+
+    /**
+     * Finds the line containing a visual row and the row's offset inside it
+     *
+     * Rows past the end map to {line count, 0}.
+     */
+    std::pair<int, int> RowIndex::locate(int row) const {
+        if (!enabled) return {row, 0};
+        if (row < 0) return {0, 0};
+        if (row >= total_rows()) return {lines, 0};
+
+        uint32_t rest = static_cast<uint32_t>(row);
+        int line = 0;
+        size_t node = 1;
+        while (node < leaf_base) {
+            if (row_tree[2 * node] > rest) {
+                node = 2 * node;
+            } else {
+                rest -= row_tree[2 * node];
+                line += static_cast<int>(line_tree[2 * node]);
+                node = 2 * node + 1;
+            }
+        }
+
+        const Block& block = blocks[node - leaf_base];
+        for (size_t at = 0;; ++at) {
+            const uint32_t count = block.hidden[at] ? 0 : block.counts[at];
+            if (count > rest) return {line + static_cast<int>(at), static_cast<int>(rest)};
+            rest -= count;
+        }
+    }
+
+    int RowIndex::total_rows() const {
+        if (!enabled) return lines;
+        return static_cast<int>(row_tree[1]);
+    }
+
+    /**
+     * Hides lines (header, last_line] behind header
+     *
+     * Flags each hidden line, apart from starting the blocks when neither
+     * wrapping nor folding was in use. Folds starting inside the range are merged
+     * into the new one; a header that is itself hidden is ignored.
+     */
+    void RowIndex::fold(const Buffer& buffer, int header, int last_line) {
+        sync(buffer);
+        last_line = std::min(last_line, lines - 1);
+        if (header < 0 || last_line <= header || fold_containing(header) >= 0) return;
+
+        if (!enabled) {
+            rebuild(buffer);
+        }
+
+        auto inner = folds.lower_bound(header);
+        while (inner != folds.end() && inner->first <= last_line) {
+            set_hidden(inner->first + 1, inner->second, false);
+            last_line = std::max(last_line, inner->second);
+            inner = folds.erase(inner);
+        }
+
+        folds.emplace(header, last_line);
+        set_hidden(header + 1, last_line, true);
+    }
+
+    void RowIndex::unfold(int header) {
+        const auto fold = folds.find(header);
+        if (fold == folds.end()) return;
+
+        set_hidden(fold->first + 1, fold->second, false);
+        folds.erase(fold);
+        if (!wrap && folds.empty()) {
+            release();
+        }
+    }
+
+    /**
+     * Last hidden line of the fold headed by line, or -1
+     */
+    int RowIndex::fold_end(int line) const {
+        const auto fold = folds.find(line);
+        return fold != folds.end() ? fold->second : -1;
+    }
+
+    /**
+     * Header of the fold that hides line, or -1 if line is visible
+     */
+    int RowIndex::fold_containing(int line) const {
+        auto fold = folds.upper_bound(line);
+        if (fold == folds.begin()) return -1;
+
+        --fold;
+        return line > fold->first && line <= fold->second ? fold->first : -1;
+    }
+
+    /**
+     * Sizes the trees for the current blocks and fills them in
+     */
+    void RowIndex::build_trees() {
+        leaf_base = 1;
+        while (leaf_base < blocks.size()) {
+            leaf_base <<= 1;
+        }
+
+        line_tree.assign(2 * leaf_base, 0);
+        row_tree.assign(2 * leaf_base, 0);
+        for (size_t block = 0; block < blocks.size(); ++block) {
+            line_tree[leaf_base + block] = static_cast<uint32_t>(blocks[block].counts.size());
+            row_tree[leaf_base + block] = blocks[block].rows;
+        }
+        for (size_t node = leaf_base - 1; node > 0; --node) {
+            line_tree[node] = line_tree[2 * node] + line_tree[2 * node + 1];
+            row_tree[node] = row_tree[2 * node] + row_tree[2 * node + 1];
+        }
+    }
+
+    /**
+     * Updates the leaves of blocks [first_block, last_block] and their
+     * ancestors, one tree level at a time; leaves past the last block
+     * are cleared
+     */
+    void RowIndex::refresh(size_t first_block, size_t last_block) {
+        for (size_t block = first_block; block <= last_block; ++block) {
+            const bool used = block < blocks.size();
+            line_tree[leaf_base + block] = used ? static_cast<uint32_t>(blocks[block].counts.size()) : 0;
+            row_tree[leaf_base + block] = used ? blocks[block].rows : 0;
+        }
+
+        for (size_t l = (leaf_base + first_block) >> 1, r = (leaf_base + last_block) >> 1; l > 0; l >>= 1, r >>= 1) {
+            for (size_t node = l; node <= r; ++node) {
+                line_tree[node] = line_tree[2 * node] + line_tree[2 * node + 1];
+                row_tree[node] = row_tree[2 * node] + row_tree[2 * node + 1];
+            }
+        }
+    }
+
+    /**
+     * Block holding a line (0 <= line < line count) and the line's
+     * position inside it
+     */
+    std::pair<size_t, size_t> RowIndex::find_line(int line) const {
+        uint32_t rest = static_cast<uint32_t>(line);
+        size_t node = 1;
+        while (node < leaf_base) {
+            if (line_tree[2 * node] > rest) {
+                node = 2 * node;
+            } else {
+                rest -= line_tree[2 * node];
+                node = 2 * node + 1;
+            }
+        }
+        return {node - leaf_base, rest};
+    }
+
+    void RowIndex::recount(Block& block) {
+        block.total = 0;
+        block.rows = 0;
+        for (size_t at = 0; at < block.counts.size(); ++at) {
+            block.total += block.counts[at];
+            if (!block.hidden[at]) block.rows += block.counts[at];
+        }
+    }
+
+    /**
+     * Cuts an overflowing block into blocks of BLOCK_LINES lines
+     */
+    void RowIndex::split(size_t block) {
+        std::vector<Block> pieces;
+        const Block& full = blocks[block];
+        for (size_t from = BLOCK_LINES; from < full.counts.size(); from += BLOCK_LINES) {
+            const size_t to = std::min(from + BLOCK_LINES, full.counts.size());
+            Block piece;
+            piece.counts.assign(full.counts.begin() + from, full.counts.begin() + to);
+            piece.measured_at.assign(full.measured_at.begin() + from, full.measured_at.begin() + to);
+            piece.hidden.assign(full.hidden.begin() + from, full.hidden.begin() + to);
+            recount(piece);
+            pieces.push_back(std::move(piece));
+        }
+
+        Block& first = blocks[block];
+        first.counts.resize(BLOCK_LINES);
+        first.measured_at.resize(BLOCK_LINES);
+        first.hidden.resize(BLOCK_LINES);
+        recount(first);
+        blocks.insert(blocks.begin() + block + 1, std::make_move_iterator(pieces.begin()), std::make_move_iterator(pieces.end()));
+    }
+
+    /**
+     * Starts the blocks over with estimated counts and current folds
+     */
+    void RowIndex::rebuild(const Buffer& buffer) {
+        enabled = true;
+        lines = buffer.line_count();
+        ++generation;
+
+        blocks.clear();
+        for (int first = 0; first < lines || blocks.empty(); first += static_cast<int>(BLOCK_LINES)) {
+            const size_t size = std::min(BLOCK_LINES, static_cast<size_t>(std::max(lines - first, 0)));
+            Block block;
+            block.counts.assign(size, 1);
+            block.measured_at.assign(size, 0);
+            block.hidden.assign(size, 0);
+            block.total = block.rows = static_cast<uint32_t>(size);
+            blocks.push_back(std::move(block));
+        }
+        build_trees();
+
+        for (const auto& [header, last_line] : folds) {
+            set_hidden(header + 1, last_line, true);
+        }
+    }
+
+    void RowIndex::release() {
+        enabled = false;
+        blocks.clear();
+        blocks.shrink_to_fit();
+        line_tree.clear();
+        line_tree.shrink_to_fit();
+        row_tree.clear();
+        row_tree.shrink_to_fit();
+    }
+
+    /**
+     * Stores a freshly measured row count for line at of block
+     */
+    void RowIndex::set_count(size_t block, size_t at, uint32_t count) {
+        Block& edited = blocks[block];
+        edited.total += count - edited.counts[at];
+        if (!edited.hidden[at]) edited.rows += count - edited.counts[at];
+        edited.counts[at] = count;
+        edited.measured_at[at] = generation;
+        refresh(block, block);
+    }
+
+    /**
+     * Hides or shows lines [first_line, last_line]
+     *
+     * Flags the lines one by one; a block that lies wholly inside the
+     * range takes its row total as is instead of being summed.
+     */
+    void RowIndex::set_hidden(int first_line, int last_line, bool hide) {
+        if (first_line > last_line) return;
+
+        const auto [first_block, first_at] = find_line(first_line);
+        size_t block = first_block;
+        size_t at = first_at;
+        for (size_t left = static_cast<size_t>(last_line - first_line) + 1; left > 0; ++block, at = 0) {
+            Block& flagged = blocks[block];
+            const size_t size = std::min(left, flagged.counts.size() - at);
+            if (size == flagged.counts.size()) {
+                std::fill(flagged.hidden.begin(), flagged.hidden.end(), hide);
+                flagged.rows = hide ? 0 : flagged.total;
+            } else {
+                for (size_t i = at; i < at + size; ++i) {
+                    if (flagged.hidden[i] == hide) continue;
+                    flagged.hidden[i] = hide;
+                    if (hide) {
+                        flagged.rows -= flagged.counts[i];
+                    } else {
+                        flagged.rows += flagged.counts[i];
+                    }
+                }
+            }
+            left -= size;
+        }
+        refresh(first_block, block - 1);
+    }
+
+    /**
+     * Moves folds after an edit of old_count lines at first_line
+     *
+     * Folds touching the edited lines are opened and forgotten, later
+     * ones shift by the change in line count.
+     */
+    void RowIndex::drop_folds(int first_line, int old_count, int new_count) {
+        const int last_edited = first_line + old_count - 1;
+        const int shift = new_count - old_count;
+
+        std::map<int, int> kept;
+        for (const auto& [header, last_line] : folds) {
+            if (last_line < first_line) {
+                kept.emplace_hint(kept.end(), header, last_line);
+            } else if (header > last_edited) {
+                kept.emplace_hint(kept.end(), header + shift, last_line + shift);
+            } else {
+                set_hidden(header + 1, last_line, false);
+            }
+        }
+        folds.swap(kept);
+    }
+
+    uint32_t RowIndex::count_rows(const Buffer& buffer, int line) const {
+        if (!wrap) return 1;
+
+        const size_t length = buffer.get_line(line).size();
+        if (length == 0) return 1;
+        return static_cast<uint32_t>((length + wrap_width - 1) / wrap_width);
+    }
+}
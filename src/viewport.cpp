@@ -6,6 +6,7 @@
 #include <fstream>
 #include <cstring>
 #include <algorithm>
+#include <climits>
 
 #include "viewport.hpp"
 
@@ -24,61 +25,170 @@ namespace Var {
      * - Line numbers
      * - Status bar with file info
      * 
-     * Uses double buffering to avoid partial screen updates.
+     * Uses double buffering to avoid partial screen updates. The back
+     * buffer is kept between frames: when only the scroll position moved
+     * by a few rows, its content is shifted with a scroll region and only
+     * the newly exposed rows (plus the old and new cursor line) are drawn.
+     * This only saves rendering; whether the terminal is scrolled or
+     * repainted is still up to the line-hash optimizer of doupdate(),
+     * which compares the whole frame with the screen. Edits reported through
+     * lines_changed() only redraw the rows of the edited lines; rows they
+     * moved are shifted like a scroll and only get new line numbers.
+     * 
+     * The frame is composed into the front buffer but not flushed, so
+     * several viewports can be drawn and sent to the terminal at once.
      * 
      * buffer    Text content to render
      * cursor    Current cursor position
      * modified  flag to show [*] indicator
      * filename  Current file name or empty for new buffer
+     * focused   Whether this viewport gets the terminal cursor
      */
-    void Viewport::draw(const Buffer& buffer, const Cursor& cursor, bool modified, const std::string& filename) {
-        update_dimensions();
-        
+    void Viewport::draw(const Buffer& buffer, const Cursor& cursor, bool modified, const std::string& filename, bool focused) {
         // Calculate text offset after line numbers to ensure proper alignment
         // even when scrolling horizontally
         const auto [cursor_line, cursor_col] = cursor.position();
-        const int text_start_col = calculate_text_start_column(cursor_line, buffer.line_count());
+        const int text_start_col = calculate_text_start_column();
+
+        // Wrapped rows depend on the text width, so settle the scroll
+        // position only after the gutter is known
+        row_index.sync(buffer);
+        row_index.set_width(width - text_start_col);
+        settle(buffer, cursor);
+        find_match(buffer, cursor);
+
+        // The table scrolls sideways by whole columns to show the cursor
+        if (csv.active()) {
+            const std::vector<CsvField> fields = CsvLayout::split(buffer.get_line(cursor_line), csv.get_delimiter());
+            if (csv.scroll_to(CsvLayout::field_at(fields, cursor_col), width - text_start_col)) {
+                invalidate();
+            }
+        }
+
+        const int text_rows = height - 1;
+        const int cursor_top = row_index.row_of_line(cursor_line) - viewport_y;
+        const int cursor_bottom = cursor_top + row_index.rows_of(cursor_line);
         
         // Renders buffer content, status bar and positions cursor
-        draw_buffer_content(buffer, cursor_line, text_start_col, cursor);
-        draw_status_bar(buffer, cursor, modified, filename);
-        position_cursor(buffer, cursor, text_start_col);
+        const bool edited = frame_revision != buffer.revision();
+        const bool damage_known = !edited || (damage_reported && !(diff && diff->active())); // diff marks move beyond the edit
+        const int shift = damage_known ? scroll_shift() : 0;
+        const bool popup = !completions.empty(); // covers rows the partial redraws don't know about
+        if (!frame_valid || popup || !damage_known || (shift == 0 && frame_y != viewport_y)) {
+            werase(back_buffer);
+            draw_rows(buffer, cursor, text_start_col, 0, text_rows);
+        } else {
+            if (shift != 0) {
+                scrollok(back_buffer, TRUE);
+                wsetscrreg(back_buffer, 0, text_rows - 1);
+                wscrl(back_buffer, shift);
+                scrollok(back_buffer, FALSE);
+
+                if (shift > 0) {
+                    draw_rows(buffer, cursor, text_start_col, text_rows - shift, text_rows);
+                } else {
+                    draw_rows(buffer, cursor, text_start_col, 0, -shift);
+                }
+            }
+            if (edited) {
+                draw_damage(buffer, cursor, text_start_col);
+            }
+
+            // Line number and cursor highlight move with the cursor line
+            draw_rows(buffer, cursor, text_start_col, frame_cursor_row - shift, frame_cursor_row - shift + frame_cursor_rows);
+            draw_rows(buffer, cursor, text_start_col, cursor_top, cursor_bottom);
+
+            // So does the matching bracket highlight
+            if (frame_match_line != match_line) {
+                draw_line_rows(buffer, cursor, text_start_col, frame_match_line);
+            }
+            draw_line_rows(buffer, cursor, text_start_col, match_line);
+        }
+        if (popup) {
+            draw_completions(buffer, cursor, text_start_col);
+        }
+        draw_status_bar(buffer, cursor, modified, filename, focused);
+
+        frame_valid = true;
+        frame_y = viewport_y;
+        frame_revision = buffer.revision();
+        frame_cursor_row = cursor_top;
+        frame_cursor_rows = cursor_bottom - cursor_top;
+        frame_match_line = match_line;
+        damage.clear();
+        renumber_from = INT_MAX;
+        damage_reported = false;
         
         swap_buffers();
+        if (focused) {
+            position_cursor(buffer, cursor, text_start_col);
+        }
     }
 
     /**
-     * Adjusts viewport to current terminal dimensions
+     * Matches the back buffer to the viewport's screen area
      * 
-     * Must be called after terminal resize events. Maintains
-     * back buffer size matching physical terminal.
+     * Must be called after the area changed (terminal resize, split).
      */
     void Viewport::update_dimensions() {
-        getmaxyx(stdscr, height, width);
-
         if (back_buffer) {
             wresize(back_buffer, height, width);
+            mvwin(back_buffer, top, left);
         }
     }
 
     /**
      * Calculates text horizontal offset accounting for line numbers
      * 
-     * When line numbers are enabled, reserves fixed-width gutter area
-     * and renders line numbers. Return value represents starting column
-     * for text content.
-     * 
-     * cursor_line  Current line for highlight positioning
-     * total_lines  Used for line number formatting width
+     * When line numbers are enabled, reserves fixed-width gutter area.
+     * Return value represents starting column for text content.
      */
-    int Viewport::calculate_text_start_column(int cursor_line, int total_lines) const {
+    int Viewport::calculate_text_start_column() const {
         if (show_line_numbers) {
-            draw_line_numbers(cursor_line, total_lines);
             return LINE_NUMBERS_WIDTH;
         }
         return 0;
     }
 
+    /**
+     * Makes the scroll position consistent with measured row counts
+     * 
+     * With soft wrap on, lines entering the screen may turn out taller
+     * than their estimate and push the cursor out of view. Measures the
+     * visible lines and re-runs cursor scrolling until it is stable.
+     */
+    void Viewport::settle(const Buffer& buffer, const Cursor& cursor) {
+        if (!row_index.active()) return;
+
+        row_index.measure(buffer, cursor.position().first);
+        // Ends once a pass measures nothing new, so the frame is never
+        // drawn from estimates
+        while (true) {
+            measure_visible(buffer);
+            const int previous_y = viewport_y;
+            cursor.adjust_viewport(buffer, row_index, viewport_y, height - 1);
+            if (viewport_y == previous_y) break;
+        }
+    }
+
+    /**
+     * Measures only the lines that cover the screen
+     * 
+     * This is where a resize is paid for: stale row counts are refreshed
+     * lazily, one screenful at a time.
+     */
+    void Viewport::measure_visible(const Buffer& buffer) {
+        int line = row_index.locate(viewport_y).first;
+        if (line >= buffer.line_count()) return;
+
+        row_index.measure(buffer, line);
+        int covered = row_index.row_of_line(line) + row_index.rows_of(line) - viewport_y;
+        while (covered < height - 1 && ++line < buffer.line_count()) {
+            row_index.measure(buffer, line);
+            covered += row_index.rows_of(line);
+        }
+    }
+
     /**
      * Renders visible portion of text buffer
      * 
@@ -89,18 +199,153 @@ namespace Var {
      * cursor_line    Currently focused line
      * text_start_col Horizontal offset for text
      * cursor         Cursor instance for position data
+     * first_row      First screen row to draw
+     * last_row       Screen row to stop before
      */
-    void Viewport::draw_buffer_content(const Buffer& buffer, int cursor_line, int text_start_col, const Cursor& cursor) {
+    void Viewport::draw_buffer_content(const Buffer& buffer, int cursor_line, int text_start_col, const Cursor& cursor, int first_row, int last_row) {
         // Only render visible lines to avoid unnecessary processing
-        for (int screen_row = 0; screen_row < height - 1; ++screen_row) {
-            const int buffer_line = viewport_y + screen_row;
+        for (int screen_row = first_row; screen_row < last_row; ++screen_row) {
+            const auto [buffer_line, sub_row] = row_index.locate(viewport_y + screen_row);
             if (buffer_line >= buffer.line_count()) break;
             
-            draw_line(buffer, buffer_line, screen_row, text_start_col, 
+            draw_line(buffer, buffer_line, sub_row, screen_row, text_start_col, 
                     buffer_line == cursor_line, cursor);
         }
     }
 
+    /**
+     * Returns the row shift that can be reused from the last frame
+     * 
+     * Non-zero only when the back buffer still holds the previous frame
+     * (edits since then are applied to it by lines_changed()) and
+     * viewport_y moved by a small amount; larger jumps are cheaper to
+     * repaint outright.
+     */
+    int Viewport::scroll_shift() const {
+        if (!frame_valid) return 0;
+
+        const int shift = viewport_y - frame_y;
+        if (std::abs(shift) > (height - 1) / MAX_SCROLL_FRACTION) return 0;
+        return shift;
+    }
+
+    /**
+     * Clears and redraws screen rows [first_row, last_row)
+     * 
+     * Draws gutter and text; rows past the end of the buffer are left
+     * blank. The range is clipped to the text area.
+     */
+    void Viewport::draw_rows(const Buffer& buffer, const Cursor& cursor, int text_start_col, int first_row, int last_row) {
+        first_row = std::max(first_row, 0);
+        last_row = std::min(last_row, height - 1);
+        if (first_row >= last_row) return;
+
+        for (int screen_row = first_row; screen_row < last_row; ++screen_row) {
+            wmove(back_buffer, screen_row, 0);
+            wclrtoeol(back_buffer);
+        }
+
+        const int cursor_line = cursor.position().first;
+        if (show_line_numbers) {
+            draw_line_numbers(cursor_line, buffer.line_count(), first_row, last_row);
+        }
+        draw_buffer_content(buffer, cursor_line, text_start_col, cursor, first_row, last_row);
+    }
+
+    /**
+     * Redraws all rows of one buffer line, if it is on screen
+     */
+    void Viewport::draw_line_rows(const Buffer& buffer, const Cursor& cursor, int text_start_col, int line) {
+        if (line < 0 || line >= buffer.line_count()) return;
+
+        const int first_row = row_index.row_of_line(line) - viewport_y;
+        draw_rows(buffer, cursor, text_start_col, first_row, first_row + row_index.rows_of(line));
+    }
+
+    /**
+     * Looks up the bracket matching the one under the cursor, if any
+     */
+    void Viewport::find_match(const Buffer& buffer, const Cursor& cursor) {
+        match_line = -1;
+        if (!brackets) return;
+
+        const auto [cursor_line, cursor_col] = cursor.position();
+        const size_t match = brackets->match(buffer, buffer.calculate_absolute_position(cursor_line, cursor_col));
+        if (match == BracketIndex::NONE) return;
+
+        match_line = buffer.find_line_for_position(match);
+        match_col = static_cast<int>(match - buffer.line_offset(match_line));
+    }
+
+    /**
+     * Redraws the rows of lines edited since the last frame, and the
+     * line numbers of the rows below them that moved
+     */
+    void Viewport::draw_damage(const Buffer& buffer, const Cursor& cursor, int text_start_col) {
+        for (const auto& [first_line, end_line] : damage) {
+            draw_rows(buffer, cursor, text_start_col, row_index.row_of_line(first_line) - viewport_y,
+                      row_index.row_of_line(end_line) - viewport_y);
+        }
+
+        if (show_line_numbers && renumber_from < buffer.line_count()) {
+            const int first_row = std::max(row_index.row_of_line(renumber_from) - viewport_y, 0);
+            draw_line_numbers(cursor.position().first, buffer.line_count(), first_row, height - 1);
+        }
+    }
+
+    /**
+     * Moves back buffer text rows from first_row down by shift rows (up
+     * when negative), blanking the rows left behind
+     */
+    void Viewport::shift_rows(int first_row, int shift) {
+        const int text_rows = height - 1;
+        if (shift == 0 || first_row >= text_rows - 1) return; // a region needs two rows; callers redraw the last one
+
+        scrollok(back_buffer, TRUE);
+        wsetscrreg(back_buffer, first_row, text_rows - 1);
+        wscrl(back_buffer, -shift);
+        scrollok(back_buffer, FALSE);
+    }
+
+    /**
+     * Marks lines [first_line, end_line) for redrawing
+     * 
+     * Overlapping and adjacent ranges are merged; past
+     * MAX_DAMAGE_RANGES everything collapses into one range.
+     */
+    void Viewport::add_damage(int first_line, int end_line) {
+        if (first_line >= end_line) return;
+
+        for (auto range = damage.begin(); range != damage.end(); ) {
+            if (range->first <= end_line && first_line <= range->second) {
+                first_line = std::min(first_line, range->first);
+                end_line = std::max(end_line, range->second);
+                range = damage.erase(range);
+            } else {
+                ++range;
+            }
+        }
+        damage.emplace_back(first_line, end_line);
+
+        if (damage.size() > MAX_DAMAGE_RANGES) {
+            for (const auto& [first, end] : damage) {
+                first_line = std::min(first_line, first);
+                end_line = std::max(end_line, end);
+            }
+            damage.assign(1, {first_line, end_line});
+        }
+    }
+
+    /**
+     * Forces the next draw() to repaint every row
+     * 
+     * Needed whenever the back buffer no longer matches what the
+     * current state would render, e.g. after a resize or a layout toggle.
+     */
+    void Viewport::invalidate() {
+        frame_valid = false;
+    }
+
     /**
      * Initializes double buffering system
      * 
@@ -109,23 +354,32 @@ namespace Var {
      * ncurses initialization.
      */
     void Viewport::init_buffers() {
-        update_dimensions();
         front_buffer = stdscr;
-        back_buffer = newwin(height, width, 0, 0);
+        back_buffer = newwin(height, width, top, left);
+        invalidate();
+    }
+
+    /**
+     * Frees the back buffer of a viewport that is going away
+     */
+    void Viewport::release_buffers() {
+        if (back_buffer) {
+            delwin(back_buffer);
+            back_buffer = nullptr;
+        }
     }
 
     /**
-     * Swaps back and front buffers with optimized rendering
+     * Copies the back buffer into its area of the front buffer
      * 
      * Uses overwrite() instead of wrefresh() for back buffer to
-     * minimize screen tearing. Maintains empty back buffer after
-     * swap for next draw cycle.
+     * minimize screen tearing. The back buffer keeps its content so
+     * the next frame can reuse unchanged rows. Flushing the front
+     * buffer to the terminal is left to the caller, once per frame
+     * for all viewports.
      */
     void Viewport::swap_buffers() {
         overwrite(back_buffer, front_buffer);
-        wrefresh(front_buffer);
-
-        werase(back_buffer);
     }
 
     /**
@@ -136,32 +390,161 @@ namespace Var {
      * 2. Line with cursor (highlighted character)
      * 3. Line end (clears remaining space)
      * 
+     * With soft wrap on only the sub_row-th width-sized segment of the
+     * line is drawn.
+     * 
      * buffer_line    Absolute line number in buffer
+     * sub_row        Wrapped segment of the line to draw
      * screen_row     Vertical position in viewport
      * start_col      Horizontal rendering offset
      * is_cursor_line Whether to show cursor highlight
      */
-    void Viewport::draw_line(const Buffer& buffer, int buffer_line, int screen_row, int start_col, bool is_cursor_line, const Cursor& cursor) {
+    void Viewport::draw_line(const Buffer& buffer, int buffer_line, int sub_row, int screen_row, int start_col, bool is_cursor_line, const Cursor& cursor) {
+        if (csv.active()) {
+            draw_csv_line(buffer, buffer_line, screen_row, start_col, is_cursor_line, cursor);
+            return;
+        }
+
         const auto& line = buffer.get_line(buffer_line);
+        const int segment_start = row_index.wrapping() ? sub_row * row_index.width() : 0;
+        const std::string_view segment = line.substr(std::min<size_t>(segment_start, line.size()));
+        const size_t segment_length = std::min<size_t>(segment.size(), std::max(width - start_col, 0));
         
-        // Base text rendering
+        // Base text rendering; clear first since a full-width segment
+        // leaves the window cursor on the next row
+        wmove(back_buffer, screen_row, start_col);
+        wclrtoeol(back_buffer);
         wattron(back_buffer, COLOR_PAIR(1));
-        mvwaddnstr(back_buffer, screen_row, start_col, line.data(), line.size());
+        waddnstr(back_buffer, segment.data(), segment_length);
         wattroff(back_buffer, COLOR_PAIR(1));
-        wclrtoeol(back_buffer);
         
         // Cursor position highlighting
         if (is_cursor_line) {
             const auto [_, cursor_col] = cursor.position();
-            const int cursor_screen_col = cursor_col + start_col;
+            const int cursor_screen_col = cursor_col - segment_start + start_col;
             
             // Only highlight if cursor is within line bounds
-            if (cursor_screen_col < width && static_cast<size_t>(cursor_col) < line.size()) {
+            if (cursor_col >= segment_start && cursor_screen_col < width && static_cast<size_t>(cursor_col) < line.size()) {
                 wattron(back_buffer, COLOR_PAIR(2));
                 mvwaddch(back_buffer, screen_row, cursor_screen_col, line[cursor_col]);
                 wattroff(back_buffer, COLOR_PAIR(2));
             }
         }
+
+        // Bracket matching the one under the cursor
+        const int match_screen_col = match_col - segment_start + start_col;
+        if (buffer_line == match_line && match_col >= segment_start && match_screen_col < width) {
+            mvwchgat(back_buffer, screen_row, match_screen_col, 1, A_REVERSE, 1, nullptr);
+        }
+
+        // Selected part of the segment
+        if (selection_begin != selection_end) {
+            const size_t segment_offset = buffer.line_offset(buffer_line) + segment.data() - line.data();
+            const size_t from = std::max(selection_begin, segment_offset);
+            const size_t to = std::min(selection_end, segment_offset + segment_length);
+            if (from < to) {
+                mvwchgat(back_buffer, screen_row, start_col + static_cast<int>(from - segment_offset),
+                         static_cast<int>(to - from), A_REVERSE, 1, nullptr);
+            }
+        }
+
+        // Folded header: say how much is hidden after its last segment
+        const int fold_end = row_index.fold_end(buffer_line);
+        if (fold_end >= 0 && sub_row == row_index.rows_of(buffer_line) - 1) {
+            const std::string marker = " ... " + std::to_string(fold_end - buffer_line) + " lines";
+            const int marker_col = start_col + static_cast<int>(segment_length);
+            if (marker_col < width) {
+                wattron(back_buffer, A_DIM);
+                mvwaddnstr(back_buffer, screen_row, marker_col, marker.c_str(), width - marker_col);
+                wattroff(back_buffer, A_DIM);
+            }
+        }
+    }
+
+    /**
+     * Renders a line as table cells, from the first scrolled-in column
+     * 
+     * Every field is cut or padded to its column width; enclosing
+     * quotes are not shown.
+     */
+    void Viewport::draw_csv_line(const Buffer& buffer, int buffer_line, int screen_row, int start_col, bool is_cursor_line, const Cursor& cursor) {
+        const std::string_view line = buffer.get_line(buffer_line);
+        const std::vector<CsvField> fields = CsvLayout::split(line, csv.get_delimiter());
+
+        wmove(back_buffer, screen_row, start_col);
+        wclrtoeol(back_buffer);
+
+        int x = start_col;
+        for (int column = csv.get_first_column(); column < static_cast<int>(fields.size()) && x < width; ++column) {
+            if (column > csv.get_first_column()) {
+                wattron(back_buffer, A_DIM);
+                mvwaddnstr(back_buffer, screen_row, x, " | ", width - x);
+                wattroff(back_buffer, A_DIM);
+                x += CsvLayout::SEPARATOR_WIDTH;
+                if (x >= width) break;
+            }
+
+            const std::string cell = CsvLayout::cell_text(line, fields[column]);
+            const int shown = std::min({static_cast<int>(cell.size()), csv.column_width(column), width - x});
+            wattron(back_buffer, COLOR_PAIR(1));
+            mvwaddnstr(back_buffer, screen_row, x, cell.c_str(), shown);
+            wattroff(back_buffer, COLOR_PAIR(1));
+            x += csv.column_width(column);
+        }
+
+        if (is_cursor_line) {
+            const int cursor_col = cursor.position().second;
+            const int col = csv.screen_col(line, fields, cursor_col);
+            if (col >= 0 && start_col + col < width && static_cast<size_t>(cursor_col) < line.size()) {
+                mvwchgat(back_buffer, screen_row, start_col + col, 1, A_NORMAL, 2, nullptr);
+            }
+        }
+    }
+
+    /**
+     * Renders the completion popup below the cursor, or above it when
+     * there is no room, lined up with the start of the typed word
+     */
+    void Viewport::draw_completions(const Buffer& buffer, const Cursor& cursor, int text_start_col) {
+        const int cursor_row = cursor.visual_row(buffer, row_index);
+        if (!is_cursor_visible(cursor_row)) return;
+
+        const int text_rows = height - 1;
+        const int count = std::min(static_cast<int>(completions.size()), text_rows - 1);
+        const int screen_row = cursor_row - viewport_y;
+        const int first_row = screen_row + 1 + count <= text_rows ? screen_row + 1 : std::max(screen_row - count, 0);
+
+        int box_width = 0;
+        for (const std::string& word : completions) {
+            box_width = std::max(box_width, static_cast<int>(word.size()) + 2);
+        }
+        box_width = std::min(box_width, width);
+        const int word_col = cursor_screen_col(buffer, cursor, text_start_col) - completion_prefix;
+        const int col = std::max(std::min(word_col - 1, width - box_width), 0); // the box has a space before the words
+
+        for (int i = 0; i < count; ++i) {
+            const chtype look = i == completion_choice ? A_BOLD : A_REVERSE;
+            wattron(back_buffer, look);
+            mvwhline(back_buffer, first_row + i, col, ' ', box_width);
+            mvwaddnstr(back_buffer, first_row + i, col + 1, completions[i].c_str(), box_width - 2);
+            wattroff(back_buffer, look);
+        }
+    }
+
+    /**
+     * Column of the cursor on screen, relative to the viewport
+     */
+    int Viewport::cursor_screen_col(const Buffer& buffer, const Cursor& cursor, int text_start_col) const {
+        auto [cursor_line, cursor_col] = cursor.position();
+        int col = std::min(cursor_col, static_cast<int>(buffer.get_line(cursor_line).size()));
+        if (row_index.wrapping()) {
+            const int cursor_row = cursor.visual_row(buffer, row_index);
+            col = std::min(col - (cursor_row - row_index.row_of_line(cursor_line)) * row_index.width(), width - text_start_col - 1);
+        } else if (csv.active()) {
+            const std::string_view line = buffer.get_line(cursor_line);
+            col = std::clamp(csv.screen_col(line, CsvLayout::split(line, csv.get_delimiter()), col), 0, std::max(width - text_start_col - 1, 0));
+        }
+        return col + text_start_col;
     }
 
     /**
@@ -171,12 +554,11 @@ namespace Var {
      * Only updates cursor position when it's within visible area.
      */
     void Viewport::position_cursor(const Buffer& buffer, const Cursor& cursor, int text_start_col) {
-        auto [cursor_line, cursor_col] = cursor.position();
+        const int cursor_row = cursor.visual_row(buffer, row_index);
         
-        if (is_cursor_visible(cursor_line)) {
-            int screen_row = cursor_line - viewport_y;
-            int screen_col = std::min(cursor_col, static_cast<int>(buffer.get_line(cursor_line).size())) + text_start_col;
-            move(screen_row, screen_col);
+        if (is_cursor_visible(cursor_row)) {
+            int screen_row = cursor_row - viewport_y;
+            move(top + screen_row, left + cursor_screen_col(buffer, cursor, text_start_col));
         }
     }
 
@@ -185,9 +567,11 @@ namespace Var {
      * 
      * Used to avoid unnecessary cursor positioning operations
      * when scrolling beyond visible area.
+     * 
+     * cursor_row  Visual row of the cursor
      */
-    bool Viewport::is_cursor_visible(int cursor_line) const {
-        return cursor_line >= viewport_y && cursor_line < viewport_y + height - 1;
+    bool Viewport::is_cursor_visible(int cursor_row) const {
+        return cursor_row >= viewport_y && cursor_row < viewport_y + height - 1;
     }
 
     /**
@@ -197,12 +581,15 @@ namespace Var {
      * - File name/path
      * - Line numbers (current/total)
      * - Modified indicator
+     * - Transient message, if any
      * - Version info (right-aligned)
      * 
-     * Uses bold formatting for better visibility.
+     * Uses bold formatting for better visibility; status bars of
+     * viewports without focus are dimmed instead.
      */
-    void Viewport::draw_status_bar(const Buffer& buffer, const Cursor& cursor, bool modified, const std::string& filename) {
-        wattron(back_buffer, COLOR_PAIR(1) | A_BOLD);
+    void Viewport::draw_status_bar(const Buffer& buffer, const Cursor& cursor, bool modified, const std::string& filename, bool focused) {
+        const attr_t style = focused ? A_BOLD : A_DIM;
+        wattron(back_buffer, COLOR_PAIR(1) | style);
         
         const auto [line, col] = cursor.position();
         const std::string display_name = filename.empty() ? "[No Name]" : filename;
@@ -214,12 +601,17 @@ namespace Var {
             line + 1, buffer.line_count(),
             line + 1, col + 1,
             modified ? "[+]" : "");
+        if (!message.empty()) {
+            wprintw(back_buffer, " | %s", message.c_str());
+        }
         
-        // Right-aligned version info
+        // Right-aligned version info, unless a message needs the room
         std::string version = "VAR 1.1";
-        mvwprintw(back_buffer, height - 1, width - version.length() - 1, "%s", version.c_str());
+        if (getcurx(back_buffer) < width - static_cast<int>(version.length()) - 1) {
+            mvwprintw(back_buffer, height - 1, width - version.length() - 1, "%s", version.c_str());
+        }
 
-        wattroff(back_buffer, COLOR_PAIR(1) | A_BOLD);
+        wattroff(back_buffer, COLOR_PAIR(1) | style);
     }
 
 
@@ -231,16 +623,46 @@ namespace Var {
      * 
      * current_line  Current line (1-based)
      * total_lines   Used for number width calculation
+     * first_row     First screen row to draw
+     * last_row      Screen row to stop before
      */
-    void Viewport::draw_line_numbers(int current_line, int total_lines) const {
-        for (int screen_row = 0; screen_row < height - 1; ++screen_row) {
-            const int line_num = viewport_y + screen_row + 1; // Convert to 1-based
+    void Viewport::draw_line_numbers(int current_line, int total_lines, int first_row, int last_row) const {
+        for (int screen_row = first_row; screen_row < last_row; ++screen_row) {
+            const auto [buffer_line, sub_row] = row_index.locate(viewport_y + screen_row);
+            const int line_num = buffer_line + 1; // Convert to 1-based
             if (line_num > total_lines) break;
     
+            // Continuation rows of a wrapped line only get the separator
+            if (sub_row > 0) {
+                mvwaddch(back_buffer, screen_row, LINE_NUMBERS_SEPARATOR_COL, ACS_VLINE);
+                continue;
+            }
+
             const bool is_current_line = (line_num == current_line + 1);
             draw_line_number(screen_row, line_num, is_current_line);
+            draw_diff_mark(screen_row, buffer_line);
         }
     }
+
+    /**
+     * Renders the diff marker of a line into the gutter
+     * 
+     * '+' added, '~' changed, '-' lines removed above ('_' below the
+     * last line). Nothing is drawn while diff mode is off.
+     */
+    void Viewport::draw_diff_mark(int screen_row, int buffer_line) const {
+        if (!diff || !diff->active()) return;
+
+        char symbol = ' ';
+        switch (diff->mark(buffer_line)) {
+            case LineMark::Added:        symbol = '+'; break;
+            case LineMark::Changed:      symbol = '~'; break;
+            case LineMark::RemovedAbove: symbol = '-'; break;
+            case LineMark::RemovedBelow: symbol = '_'; break;
+            case LineMark::None:         return;
+        }
+        mvwaddch(back_buffer, screen_row, DIFF_MARK_COL, symbol | A_BOLD);
+    }
     
     /**
      * Renders single line number entry
@@ -262,17 +684,22 @@ namespace Var {
     }
 
     /**
-     * Updates the viewport dimensions
+     * Moves the viewport to a screen area
      * 
      * Used for external control of viewport size (e.g., when handling terminal
-     * resize events). Only sets the values - doesn't trigger layout recalculation.
+     * resize events or splitting the screen). The next draw() repaints.
      * 
+     * new_top, new_left  Screen position of the top left corner
      * w New width in characters
-     * h New height in lines
+     * h New height in lines (status bar included)
      */
-    void Viewport::update_size(int w, int h) {
+    void Viewport::place(int new_top, int new_left, int w, int h) {
+        top = new_top;
+        left = new_left;
         width = w;
         height = h;
+        update_dimensions();
+        invalidate();
     }
 
     /**
@@ -284,18 +711,233 @@ namespace Var {
      */
     void Viewport::toggle_line_numbers() {
         show_line_numbers = !show_line_numbers;
+        invalidate();
+    }
+
+    /**
+     * Toggles soft wrapping of long lines
+     * 
+     * Keeps the same buffer line at the top of the screen when
+     * switching between line-based and row-based scrolling.
+     */
+    void Viewport::toggle_soft_wrap(const Buffer& buffer) {
+        const int top_line = row_index.locate(viewport_y).first;
+
+        if (row_index.wrapping()) {
+            row_index.disable(buffer);
+        } else {
+            row_index.enable(buffer, width - calculate_text_start_column());
+            csv.disable(); // table rows don't wrap
+        }
+        viewport_y = row_index.row_of_line(top_line);
+        invalidate();
+    }
+
+    /**
+     * Switches between plain lines and the table view
+     * 
+     * Returns false if the buffer has no recognisable delimiter. Soft
+     * wrap is turned off for the table.
+     */
+    bool Viewport::toggle_csv(const Buffer& buffer) {
+        if (csv.active()) {
+            csv.disable();
+            invalidate();
+            return true;
+        }
+
+        if (!csv.enable(buffer)) return false;
+        if (row_index.wrapping()) {
+            toggle_soft_wrap(buffer);
+        }
+        invalidate();
+        return true;
+    }
+
+    const CsvLayout* Viewport::csv_layout() const {
+        return csv.active() ? &csv : nullptr;
+    }
+
+    /**
+     * Hides lines (header, last_line] behind header
+     * 
+     * Keeps the line at the top of the screen in place when it is not
+     * itself folded away.
+     */
+    void Viewport::fold(const Buffer& buffer, int header, int last_line) {
+        const int top_line = row_index.locate(viewport_y).first;
+        row_index.fold(buffer, header, last_line);
+        viewport_y = row_index.row_of_line(top_line);
+        invalidate();
+    }
+
+    void Viewport::unfold(int header) {
+        const int top_line = row_index.locate(viewport_y).first;
+        row_index.unfold(header);
+        viewport_y = row_index.row_of_line(top_line);
+        invalidate();
+    }
+
+    /**
+     * Opens the fold hiding line, if any, so the cursor can stand on it
+     */
+    void Viewport::reveal(int line) {
+        const int header = row_index.fold_containing(line);
+        if (header >= 0) {
+            unfold(header);
+        }
+    }
+
+    /**
+     * Reports an edit that replaced old_count lines with new_count
+     * 
+     * Only the touched lines are re-measured for wrapping, and only
+     * their rows are marked for redrawing. Rows the edit moves are
+     * shifted in the back buffer and only renumbered. An edit above the
+     * top of the screen (made through another viewport) keeps the same
+     * text in view, so it changes nothing but the line numbers.
+     */
+    void Viewport::lines_changed(const Buffer& buffer, int first_line, int old_count, int new_count) {
+        const auto [top_line, top_sub_row] = row_index.locate(viewport_y);
+        const auto [frame_line, frame_sub_row] = row_index.locate(frame_y);
+        const int rows_before = row_index.total_rows();
+        const int first_row = row_index.row_of_line(first_line) - frame_y; // in the back buffer
+        const int old_rows = row_index.row_of_line(first_line + old_count) - row_index.row_of_line(first_line);
+
+        row_index.splice(buffer, first_line, old_count, new_count);
+
+        const int new_rows = row_index.row_of_line(first_line + new_count) - row_index.row_of_line(first_line);
+        const int end_line = first_line + old_count; // first line after the edit, as numbered before it
+        const int line_shift = new_count - old_count;
+        const int row_shift = new_rows - old_rows;
+        damage_reported = true;
+
+        // Damage from earlier edits moves with the lines below this one
+        for (auto& [first, end] : damage) {
+            first = first <= first_line ? first : (first >= end_line ? first + line_shift : first_line);
+            end = end <= first_line ? end : (end >= end_line ? end + line_shift : first_line + new_count);
+        }
+        add_damage(first_line, first_line + new_count);
+        if (line_shift != 0) {
+            const int renumbered = renumber_from != INT_MAX && renumber_from >= end_line ? renumber_from + line_shift : renumber_from;
+            renumber_from = std::min(renumbered, first_line + new_count);
+        }
+        if (frame_match_line >= end_line) {
+            frame_match_line += line_shift;
+        }
+
+        if (row_index.total_rows() - rows_before != row_shift) {
+            invalidate(); // rows past the edit changed as well, e.g. a fold around it was dropped
+        } else if (frame_valid && row_shift != 0) {
+            const int text_rows = height - 1;
+            if (end_line <= frame_line) {
+                frame_y = row_index.row_of_line(frame_line + line_shift) + frame_sub_row;
+            } else if (first_row < 0) {
+                invalidate(); // cuts through the top row
+            } else if (first_row < text_rows) {
+                shift_rows(first_row + std::min(old_rows, new_rows), row_shift);
+                if (frame_cursor_row >= first_row + old_rows) {
+                    frame_cursor_row += row_shift;
+                }
+
+                // Rows pulled up from below the screen are still blank
+                const int exposed = std::max(text_rows + row_shift, first_row + new_rows);
+                if (exposed < text_rows) {
+                    add_damage(row_index.locate(frame_y + exposed).first, row_index.locate(frame_y + text_rows - 1).first + 1);
+                }
+            }
+        }
+
+        if ((line_shift != 0 || row_shift != 0) && end_line <= top_line) {
+            viewport_y = row_index.row_of_line(top_line + line_shift) + top_sub_row;
+        }
+    }
+
+    /**
+     * Gives read access to the line -> visual row mapping
+     * 
+     * Cursor movement and scrolling use it to step by visual rows.
+     */
+    const RowIndex& Viewport::rows() const {
+        return row_index;
+    }
+
+    /**
+     * Number of text rows on screen (everything except the status bar)
+     * 
+     * Used as the step size of page up/down.
+     */
+    int Viewport::page_rows() const {
+        return std::max(height - 1, 1);
+    }
+
+    /**
+     * Sets the transient status bar message
+     * 
+     * An empty string clears it. Shown from the next draw() call.
+     */
+    void Viewport::set_message(const std::string& text) {
+        message = text;
+    }
+
+    /**
+     * Connects the diff whose markers are shown in the gutter
+     * 
+     * The viewport only reads it; nullptr disconnects.
+     */
+    void Viewport::set_diff(const DiskDiff* disk_diff) {
+        diff = disk_diff;
+        invalidate();
+    }
+
+    void Viewport::set_brackets(const BracketIndex* bracket_index) {
+        brackets = bracket_index;
+        invalidate();
+    }
+
+    /**
+     * Highlights buffer offsets [begin, end); equal offsets clear it
+     */
+    void Viewport::set_selection(size_t begin, size_t end) {
+        if (begin == selection_begin && end == selection_end) return;
+
+        selection_begin = begin;
+        selection_end = end;
+        invalidate();
+    }
+
+    std::pair<size_t, size_t> Viewport::selection() const {
+        return {selection_begin, selection_end};
+    }
+
+    /**
+     * Shows words offered for the prefix_length bytes before the
+     * cursor, choice highlighted; no words hide the popup
+     */
+    void Viewport::set_completions(const std::vector<std::string>& words, int choice, int prefix_length) {
+        if (words.empty() && completions.empty()) return;
+
+        completions = words;
+        completion_choice = choice;
+        completion_prefix = prefix_length;
+        invalidate();
     }
 
     /**
      * Gets current vertical viewport position
      * 
-     * Position is measured in buffer lines and indicates
-     * which line appears at the top of the display area.
+     * Position is measured in visual rows (buffer lines unless
+     * soft wrap is on) and indicates what appears at the top of
+     * the display area.
      */
     int Viewport::get_y() const {
         return viewport_y;
     }
 
+    WindowRect Viewport::area() const {
+        return {top, left, width, height};
+    }
+
     /**
      * Sets vertical viewport position
      * 
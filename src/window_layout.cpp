@@ -0,0 +1,95 @@
+#include "window_layout.hpp"
+
+namespace Var {
+
+    WindowLayout::WindowLayout() : root(std::make_unique<Node>()) {
+        root->window = 0;
+    }
+
+    /**
+     * Splits a window's area in two; window keeps the top (or left)
+     * half and new_window gets the other
+     */
+    void WindowLayout::split(int window, bool side_by_side, int new_window) {
+        Node* leaf = find(root.get(), window, nullptr);
+        if (!leaf) return;
+
+        leaf->first = std::make_unique<Node>();
+        leaf->first->window = window;
+        leaf->second = std::make_unique<Node>();
+        leaf->second->window = new_window;
+        leaf->side_by_side = side_by_side;
+        leaf->window = -1;
+    }
+
+    /**
+     * Removes a window, renumbering the ones after it down by one
+     */
+    void WindowLayout::close(int window) {
+        Node* parent = nullptr;
+        Node* leaf = find(root.get(), window, &parent);
+        if (!leaf || !parent) return;
+
+        std::unique_ptr<Node> sibling = std::move(parent->first.get() == leaf ? parent->second : parent->first);
+        *parent = std::move(*sibling);
+        renumber(root.get(), window);
+    }
+
+    /**
+     * Computes the area of every window and of the separators between
+     * side by side windows for a screen of width x height
+     */
+    void WindowLayout::arrange(int width, int height, std::vector<WindowRect>& windows,
+                               std::vector<WindowRect>& separators) const {
+        separators.clear();
+        arrange_node(root.get(), {0, 0, width, height}, windows, separators);
+    }
+
+    WindowLayout::Node* WindowLayout::find(Node* node, int window, Node** parent) {
+        if (node->window == window) return node;
+        if (node->window >= 0) return nullptr;
+
+        for (Node* child : {node->first.get(), node->second.get()}) {
+            if (Node* found = find(child, window, parent)) {
+                if (parent && found == child) *parent = node;
+                return found;
+            }
+        }
+        return nullptr;
+    }
+
+    void WindowLayout::renumber(Node* node, int closed) {
+        if (node->window > closed) {
+            --node->window;
+        } else if (node->window < 0) {
+            renumber(node->first.get(), closed);
+            renumber(node->second.get(), closed);
+        }
+    }
+
+    void WindowLayout::arrange_node(const Node* node, WindowRect area, std::vector<WindowRect>& windows,
+                                    std::vector<WindowRect>& separators) {
+        if (node->window >= 0) {
+            if (windows.size() <= static_cast<size_t>(node->window)) {
+                windows.resize(node->window + 1);
+            }
+            windows[node->window] = area;
+            return;
+        }
+
+        WindowRect first = area;
+        WindowRect second = area;
+        if (node->side_by_side) {
+            first.width = (area.width - 1) / 2;
+            second.left = area.left + first.width + 1;
+            second.width = area.width - first.width - 1;
+            separators.push_back({area.top, area.left + first.width, 1, area.height});
+        } else {
+            first.height = area.height / 2;
+            second.top = area.top + first.height;
+            second.height = area.height - first.height;
+        }
+        arrange_node(node->first.get(), first, windows, separators);
+        arrange_node(node->second.get(), second, windows, separators);
+    }
+}
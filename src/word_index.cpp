@@ -0,0 +1,207 @@
+#include <algorithm>
+#include <cctype>
+#include <unordered_map>
+
+#include "word_index.hpp"
+
+namespace Var {
+
+    bool WordIndex::is_word_char(char ch) {
+        return isalnum(static_cast<unsigned char>(ch)) || ch == '_';
+    }
+
+    /**
+     * Adds the words of one slice (from next_slice()) to tally
+     *
+     * Words are counted as views into the slice first, so each one is
+     * copied only once per slice.
+     */
+    void WordIndex::count(const std::string& slice, Tally& tally) {
+        std::unordered_map<std::string_view, int> seen;
+        for_each_word(slice, 0, slice.size(), [&](std::string_view word) {
+            ++seen[word];
+        });
+
+        for (const auto& [word, occurrences] : seen) {
+            tally[std::string(word)] += occurrences;
+        }
+    }
+
+    /**
+     * Turns the tally of a finished count into the sorted table, moving
+     * the words instead of copying them
+     */
+    WordIndex::Counts WordIndex::sort(Tally&& tally) {
+        std::vector<std::pair<std::string, int>> sorted;
+        sorted.reserve(tally.size());
+        while (!tally.empty()) {
+            auto node = tally.extract(tally.begin());
+            sorted.emplace_back(std::move(node.key()), node.mapped());
+        }
+        std::sort(sorted.begin(), sorted.end());
+
+        Counts counts;
+        for (auto& [word, occurrences] : sorted) {
+            counts.emplace_hint(counts.end(), std::move(word), occurrences);
+        }
+        return counts;
+    }
+
+    /**
+     * Forgets all words before a new count; returns the generation the
+     * count has to be merged with
+     */
+    uint64_t WordIndex::reset() {
+        counts.clear();
+        built = false;
+        sliced = 0;
+        return ++generation;
+    }
+
+    /**
+     * Copies the next COUNT_SLICE bytes or so of text for the count,
+     * ending between two words; empty once all of text was handed out
+     */
+    std::string WordIndex::next_slice(const std::string& text) {
+        if (sliced >= text.size()) {
+            sliced = std::string::npos; // from now on every edit is a difference
+            return {};
+        }
+
+        const size_t limit = std::min(sliced + COUNT_SLICE, text.size());
+        const size_t end = around(text, limit, limit).second;
+        std::string slice = text.substr(sliced, end - sliced);
+        sliced = end;
+        return slice;
+    }
+
+    /**
+     * Takes in a finished count, adding the edits reported since its
+     * slices were taken. Returns false for the result of a count that
+     * was superseded by reset().
+     */
+    bool WordIndex::merge(Counts&& fresh, uint64_t count_generation) {
+        if (count_generation != generation) return false;
+
+        for (const auto& [word, change] : counts) {
+            const auto entry = fresh.try_emplace(word, 0).first;
+            entry->second += change;
+            if (entry->second <= 0) {
+                fresh.erase(entry);
+            }
+        }
+        counts.swap(fresh);
+        built = true;
+        return true;
+    }
+
+    bool WordIndex::ready() const {
+        return built;
+    }
+
+    /**
+     * Reports that text[begin, end) is about to be replaced; the words
+     * touching it stop counting
+     *
+     * While counting, only words of text already sliced are taken off.
+     * An edit reaching past the sliced text moves its end back to the
+     * edit, so a later slice reads the edited words instead.
+     */
+    void WordIndex::before_edit(const std::string& text, size_t begin, size_t end) {
+        const auto [from, to] = around(text, begin, end);
+        removed = end - begin;
+        if (to <= sliced) {
+            add_words(text, from, to, -1);
+        } else if (from < sliced) {
+            add_words(text, from, sliced, -1);
+            sliced = from;
+        }
+    }
+
+    /**
+     * Reports that text[begin, end) was just inserted (begin == end
+     * after a deletion); the words touching it count again
+     */
+    void WordIndex::after_edit(const std::string& text, size_t begin, size_t end) {
+        const auto [from, to] = around(text, begin, end);
+        if (from >= sliced) return; // read with a later slice
+
+        add_words(text, from, to, 1);
+        if (sliced != std::string::npos) {
+            sliced = sliced + (end - begin) - removed;
+        }
+    }
+
+    /**
+     * Up to limit words that start with prefix (but are longer), most
+     * frequent first, equally frequent ones in alphabetical order
+     *
+     * Only the first MAX_SCANNED_WORDS candidates are looked at, so a
+     * one-letter prefix in a file with millions of different words
+     * still answers in well under a millisecond.
+     */
+    std::vector<std::string> WordIndex::complete(std::string_view prefix, size_t limit) const {
+        std::vector<Counts::const_iterator> best;
+        if (!built || limit == 0) return {};
+
+        size_t scanned = 0;
+        for (auto entry = counts.lower_bound(prefix); entry != counts.end() && scanned++ < MAX_SCANNED_WORDS; ++entry) {
+            const std::string& word = entry->first;
+            if (word.compare(0, prefix.size(), prefix) != 0) break;
+            if (word.size() == prefix.size()) continue;
+            if (best.size() == limit && entry->second <= best.back()->second) continue;
+
+            // Keep best ordered by count; later words lose ties
+            const auto place = std::upper_bound(best.begin(), best.end(), entry->second,
+                [](int occurrences, Counts::const_iterator other) { return occurrences > other->second; });
+            best.insert(place, entry);
+            if (best.size() > limit) best.pop_back();
+        }
+
+        std::vector<std::string> words;
+        for (const Counts::const_iterator& entry : best) {
+            words.push_back(entry->first);
+        }
+        return words;
+    }
+
+    /**
+     * Widens [begin, end) to whole words at both ends
+     */
+    std::pair<size_t, size_t> WordIndex::around(const std::string& text, size_t begin, size_t end) {
+        while (begin > 0 && is_word_char(text[begin - 1])) --begin;
+        while (end < text.size() && is_word_char(text[end])) ++end;
+        return {begin, end};
+    }
+
+    /**
+     * Calls visit for every word in text[begin, end), which must not
+     * cut a word in two
+     */
+    void WordIndex::for_each_word(const std::string& text, size_t begin, size_t end, const std::function<void(std::string_view)>& visit) {
+        size_t pos = begin;
+        while (pos < end) {
+            while (pos < end && !is_word_char(text[pos])) ++pos;
+            const size_t start = pos;
+            while (pos < end && is_word_char(text[pos])) ++pos;
+
+            const size_t length = pos - start;
+            if (length >= MIN_WORD_LENGTH && length <= MAX_WORD_LENGTH && !isdigit(static_cast<unsigned char>(text[start]))) {
+                visit(std::string_view(text).substr(start, length));
+            }
+        }
+    }
+
+    void WordIndex::add_words(const std::string& text, size_t begin, size_t end, int delta) {
+        for_each_word(text, begin, end, [&](std::string_view word) {
+            auto entry = counts.find(word);
+            if (entry == counts.end()) {
+                entry = counts.emplace(word, 0).first;
+            }
+            entry->second += delta;
+            if (entry->second == 0) {
+                counts.erase(entry);
+            }
+        });
+    }
+}
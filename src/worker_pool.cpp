@@ -0,0 +1,94 @@
+#include <algorithm>
+
+#include "worker_pool.hpp"
+
+namespace Var {
+
+    /**
+     * thread_count  Number of workers, 0 for one per hardware thread
+     */
+    WorkerPool::WorkerPool(size_t thread_count)
+        : thread_count(thread_count > 0 ? thread_count : std::max(1u, std::thread::hardware_concurrency())) {}
+
+    WorkerPool::~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(jobs_mutex);
+            stopping = true;
+        }
+        jobs_ready.notify_all();
+
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+
+    void WorkerPool::submit(std::function<void()> job) {
+        {
+            std::lock_guard<std::mutex> lock(jobs_mutex);
+            if (threads.empty()) {
+                start();
+            }
+            jobs.push_back(std::move(job));
+        }
+        jobs_ready.notify_one();
+    }
+
+    /**
+     * Runs body over [0, count) split into ranges of at least grain items
+     *
+     * Blocks until every range is done. Small inputs run inline on the
+     * calling thread.
+     */
+    void WorkerPool::parallel_for(size_t count, size_t grain, const std::function<void(size_t, size_t)>& body) {
+        grain = std::max<size_t>(grain, 1);
+        const size_t chunks = std::min(thread_count, (count + grain - 1) / grain);
+        if (chunks <= 1) {
+            body(0, count);
+            return;
+        }
+
+        // Rounding the step up can leave fewer ranges than chunks
+        const size_t step = (count + chunks - 1) / chunks;
+        std::mutex done_mutex;
+        std::condition_variable all_done;
+        size_t remaining = (count + step - 1) / step;
+
+        for (size_t begin = 0; begin < count; begin += step) {
+            const size_t end = std::min(begin + step, count);
+            submit([&, begin, end] {
+                body(begin, end);
+
+                std::lock_guard<std::mutex> lock(done_mutex);
+                if (--remaining == 0) all_done.notify_one();
+            });
+        }
+
+        std::unique_lock<std::mutex> lock(done_mutex);
+        all_done.wait(lock, [&] { return remaining == 0; });
+    }
+
+    size_t WorkerPool::size() const {
+        return thread_count;
+    }
+
+    void WorkerPool::start() {
+        for (size_t i = 0; i < thread_count; ++i) {
+            threads.emplace_back(&WorkerPool::work, this);
+        }
+    }
+
+    void WorkerPool::work() {
+        while (true) {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(jobs_mutex);
+                jobs_ready.wait(lock, [this] { return stopping || !jobs.empty(); });
+                if (jobs.empty()) return;
+
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+            job();
+        }
+    }
+}